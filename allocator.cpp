@@ -2,7 +2,13 @@
 #include "structs.h"
 #include "splashkit.h"
 #include "allocator.h"
+#include "incremental.h"
+#include "roles.h"
+#include "categories.h"
+#include "availability.h"
+#include "optimizer.h"
 #include <vector>
+#include <algorithm>
 
 using std::to_string;
 using std::vector;
@@ -19,13 +25,13 @@ int choose_best_team_index(const vector<team> &teams)
     }
 
     int best_index = 0;
-    int best_score = teams[0].total_score;
+    long long best_score = teams[0].total_score;
     int best_size = teams[0].size;
 
     // loop and check for the team with the lowest score
     for (int i = 1; i < teams.size(); i++)
     {
-        int sc = teams[i].total_score;
+        long long sc = teams[i].total_score;
         int sz = teams[i].size;
 
         // choose team with the lowest score, or smaller size if the scores end up tied
@@ -44,14 +50,70 @@ int choose_best_team_index(const vector<team> &teams)
 /**
  * allocate the teams
  */
-vector<team> allocate_teams(vector<student> students, int num_teams)
+vector<team> allocate_teams(const vector<student> &students, int num_teams, const constraint_store *cs, balance_mode mode)
 {
-    vector<team> teams;
-
     // must have at least one team
     if (num_teams <= 0)
     {
         write_line("Number of teams must be > 0.");
+        return vector<team>();
+    }
+
+    // error handling for if no students exist
+    if (students.empty())
+    {
+        write_line("No students provided.");
+    }
+
+    vector<team> teams = allocate_teams_in_order(students, order_by_score(students), num_teams, cs);
+
+    // the greedy pass only looks at totals, so spread the categorical columns afterwards
+    if (category_count() > 0)
+    {
+        balance_categories(teams, cs, mode);
+    }
+
+    // and give teams that can't meet a chance to swap into common slots
+    if (availability_slots() > 0)
+    {
+        repair_availability(teams, cs, mode);
+    }
+
+    int violations = count_constraint_violations(cs, teams);
+    if (violations > 0)
+    {
+        write_line("Could not honour " + to_string(violations) + " constraints.");
+    }
+
+    // final message confirming how many teams were formed
+    write_line("Team allocation finished: " + to_string(num_teams) + " teams formed.");
+    return teams;
+}
+
+/**
+ * sort student indices by score, highest first
+ */
+vector<int> order_by_score(const vector<student> &students)
+{
+    vector<int> order(students.size());
+    for (int i = 0; i < students.size(); i++)
+    {
+        order[i] = i;
+    }
+
+    std::stable_sort(order.begin(), order.end(), [&students](int a, int b)
+                     { return students[a].student_score > students[b].student_score; });
+    return order;
+}
+
+/**
+ * the greedy allocation: each student (best first) joins the team with the lowest total
+ */
+vector<team> allocate_teams_in_order(const vector<student> &students, const vector<int> &order, int num_teams, const constraint_store *cs)
+{
+    vector<team> teams;
+    if (num_teams <= 0)
+    {
         return teams;
     }
 
@@ -60,75 +122,93 @@ vector<team> allocate_teams(vector<student> students, int num_teams)
     for (int i = 0; i < num_teams; i++)
     {
         teams[i].members.clear();
+        teams[i].members.reserve(order.size() / num_teams + 1);
         teams[i].size = 0;
         teams[i].total_score = 0;
         teams[i].hasLeader = false;
+        teams[i].leaders = 0;
         teams[i].id = i + 1;
     }
 
-    // number of students available
-    int n = students.size();
-
-    // error handling for if no students exist
-    if (n == 0)
+    // the heap keeps choose_best_team_index's order (lowest total, then smaller size), so each pick is O(log k)
+    team_heap best;
+    heap_reset(best, num_teams);
+    for (int i = 0; i < num_teams; i++)
     {
-        write_line("No students provided.");
-        return teams;
+        heap_push(best, teams, i);
     }
 
-    // main loop
-    while (n > 0)
+    // pinned students go in before anyone else, in score order like everybody
+    bool constrained = has_constraints(cs);
+    team_masks masks;
+    vector<bool> placed;
+    if (constrained)
     {
-        // find highest scoring student
-        int best_student_index = 0;
-        int best_student_score = students[0].student_score;
-        for (int i = 1; i < n; i++)
+        masks.words = cs->words;
+        masks.bits.assign((size_t)num_teams * cs->words, 0);
+        placed.assign(students.size(), false);
+
+        for (int i = 0; i < order.size(); i++)
         {
-            if (students[i].student_score > best_student_score)
+            const student &s = students[order[i]];
+            int pin = pinned_team_of(cs, s);
+            if (pin != -1 && pin < num_teams)
             {
-                best_student_index = i;
-                best_student_score = students[i].student_score;
+                add_member_to_team(teams[pin], s);
+                mask_toggle(cs, masks, pin, s);
+                heap_update(best, teams, pin);
+                placed[order[i]] = true;
             }
         }
+    }
 
-        // pick best team
-        int team_index = choose_best_team_index(teams);
-        if (team_index == -1)
+    // main loop
+    vector<int> skipped;
+    for (int i = 0; i < order.size(); i++)
+    {
+        const student &s = students[order[i]];
+        int team_index = heap_top(best);
+
+        if (constrained)
         {
-            team_index = 0;
-        }
+            if (placed[order[i]])
+            {
+                continue;
+            }
 
-        // assign student to chosen team
-        teams[team_index].members.push_back(students[best_student_index]);
-        teams[team_index].size = teams[team_index].members.size();
-        teams[team_index].total_score += students[best_student_index].student_score;
+            // take teams off the heap until one has nobody s must be kept apart from
+            while (team_index != -1 && !fits_mask(cs, masks, team_index, s, nullptr))
+            {
+                skipped.push_back(team_index);
+                heap_remove(best, teams, team_index);
+                team_index = heap_top(best);
+            }
+            for (int j = 0; j < skipped.size(); j++)
+            {
+                heap_push(best, teams, skipped[j]);
+            }
 
-        // mark if this team has a leader now
-        if (students[best_student_index].leadership >= LEADER_THRESHOLD)
-        {
-            teams[team_index].hasLeader = true;
+            // no team works, the best one takes them anyway (reported by the caller)
+            if (team_index == -1)
+            {
+                team_index = heap_top(best);
+            }
+            skipped.clear();
+            mask_toggle(cs, masks, team_index, s);
         }
 
-        // remove student from eligible students to swap from
-        if (best_student_index != n - 1)
-        {
-            student temp = students[best_student_index];
-            students[best_student_index] = students[n - 1];
-            students[n - 1] = temp;
-        }
-        students.pop_back();
-        n = n - 1;
+        // assign student to chosen team (this also marks if the team has a leader now)
+        add_member_to_team(teams[team_index], s);
+        heap_update(best, teams, team_index);
     }
 
-    // final message confirming how many teams were formed
-    write_line("Team allocation finished: " + to_string(num_teams) + " teams formed.");
     return teams;
 }
 
 /**
- * ensure every team has a leader
+ * ensure every team covers every role
  */
-void ensure_leader_present(vector<team> &teams)
+void ensure_leader_present(vector<team> &teams, bool verbose, const constraint_store *cs)
 {
     int k = teams.size();
 
@@ -137,29 +217,14 @@ void ensure_leader_present(vector<team> &teams)
         return;
     }
 
-    // compute which teams have at least one leader
-    for (int i = 0; i < k; i++)
-    {
-        bool found = false;
-
-        // go thru all members of this team to find which teams have at least one leader
-        for (int j = 0; j < teams[i].members.size(); j++)
-        {
-            if (teams[i].members[j].leadership >= LEADER_THRESHOLD)
-            {
-                found = true;
-                break;
-            }
-        }
-
-        teams[i].hasLeader = found;
-    }
+    unsigned required = required_roles();
+    const vector<role_rule> &rules = role_rules();
 
-    // put teams with a missing leader into another vector
+    // teams missing a role, straight from the role counts
     vector<int> missing;
     for (int i = 0; i < k; i++)
     {
-        if (!teams[i].hasLeader)
+        if (required & ~team_coverage(teams[i]))
         {
             missing.push_back(i);
         }
@@ -167,119 +232,91 @@ void ensure_leader_present(vector<team> &teams)
 
     if (missing.empty())
     {
-        write_line("All teams already have a leader.");
-        return;
-    }
-
-    // find teams with more than one eligble leader to act as a donor team
-
-    vector<int> donors;
-
-    for (int i = 0; i < k; i++)
-    {
-        int leaderCount = 0;
-        for (int j = 0; j < teams[i].members.size(); j++)
-        {
-            if (teams[i].members[j].leadership >= LEADER_THRESHOLD)
-            {
-                leaderCount++;
-            }
-        }
-        if (leaderCount > 1)
+        if (verbose)
         {
-            donors.push_back(i);
+            write_line("All teams already cover every role.");
         }
+        return;
     }
 
-    // swap so that every team has a leader
+    // swap so that every team covers each role
     for (int mi = 0; mi < missing.size(); mi++)
     {
         int missindex = missing[mi];
-        bool fixed = false;
 
-        for (int di = 0; di < donors.size(); di++)
+        for (int r = 0; r < rules.size(); r++)
         {
-            int donorindex = donors[di];
-
-            if (donorindex == missindex)
+            if (teams[missindex].role_counts[r] > 0)
             {
                 continue;
             }
 
-            // find a leader in donor
-            int leaderPos = -1;
-            for (int p = 0; p < teams[donorindex].members.size(); p++)
+            bool fixed = false;
+            for (int donorindex = 0; donorindex < k && !fixed; donorindex++)
             {
-                if (teams[donorindex].members[p].leadership >= LEADER_THRESHOLD)
+                // only a team with the role twice can give one away
+                if (donorindex == missindex || teams[donorindex].role_counts[r] < 2)
                 {
-                    leaderPos = p;
-                    break;
+                    continue;
                 }
-            }
-
-            // error handling (and a just in case factor!)
-
-            if (leaderPos == -1)
-            {
-                continue;
-            }
-
-            // find a non-leader in missing team
-            int nonLeaderPos = -1;
 
-            for (int p = 0; p < teams[missindex].members.size(); p++)
-            {
-                if (teams[missindex].members[p].leadership < LEADER_THRESHOLD)
+                const team &donor = teams[donorindex];
+                const team &receiver = teams[missindex];
+                unsigned donor_cover = team_coverage(donor);
+                unsigned donor_sole = team_sole_roles(donor);
+                unsigned receiver_cover = team_coverage(receiver);
+                unsigned receiver_sole = team_sole_roles(receiver);
+
+                // a donor member with the role and a receiver member to trade, without either team losing a role it has
+                int givePos = -1;
+                int takePos = -1;
+                for (int p = 0; p < donor.members.size() && givePos == -1; p++)
                 {
-                    nonLeaderPos = p;
-                    break;
+                    unsigned give = donor.members[p].roles;
+                    if (!((give >> r) & 1u))
+                    {
+                        continue;
+                    }
+
+                    for (int q = 0; q < receiver.members.size(); q++)
+                    {
+                        unsigned take = receiver.members[q].roles;
+                        unsigned donor_after = coverage_after_swap(donor_cover, donor_sole, give, take);
+                        unsigned receiver_after = coverage_after_swap(receiver_cover, receiver_sole, take, give);
+
+                        if ((donor_cover & ~donor_after) || (receiver_cover & ~receiver_after))
+                        {
+                            continue;
+                        }
+                        if (!fits_team(cs, teams, missindex, donor.members[p], q) || !fits_team(cs, teams, donorindex, receiver.members[q], p))
+                        {
+                            continue;
+                        }
+
+                        givePos = p;
+                        takePos = q;
+                        break;
+                    }
                 }
-            }
 
-            // crash handling, although this shouldn't happen
-            if (nonLeaderPos == -1)
-            {
-                continue;
-            }
+                if (givePos == -1)
+                {
+                    continue;
+                }
 
-            // perform the swap
-            student temp = teams[donorindex].members[leaderPos];
-            teams[donorindex].members[leaderPos] = teams[missindex].members[nonLeaderPos];
-            teams[missindex].members[nonLeaderPos] = temp;
+                swap_members(teams[donorindex], givePos, teams[missindex], takePos);
+                fixed = true;
 
-            // recompute donor team stats
-            teams[donorindex].total_score = 0;
-            teams[donorindex].hasLeader = false;
-            for (int p = 0; p < teams[donorindex].members.size(); p++)
-            {
-                teams[donorindex].total_score += teams[donorindex].members[p].student_score;
-                if (teams[donorindex].members[p].leadership >= LEADER_THRESHOLD)
-                    teams[donorindex].hasLeader = true;
+                if (verbose)
+                {
+                    write_line("Swapped a " + rules[r].name + " from Team " + to_string(donorindex + 1) + " to Team " + to_string(missindex + 1));
+                }
             }
 
-            teams[donorindex].size = teams[donorindex].members.size();
-
-            // recompute missing team stats
-            teams[missindex].total_score = 0;
-            teams[missindex].hasLeader = false;
-
-            for (int p = 0; p < teams[missindex].members.size(); p++)
+            if (!fixed && verbose)
             {
-                teams[missindex].total_score += teams[missindex].members[p].student_score;
-                if (teams[missindex].members[p].leadership >= LEADER_THRESHOLD)
-                    teams[missindex].hasLeader = true;
+                write_line("Could not find a " + rules[r].name + " swap for Team " + to_string(missindex + 1) + ". Not enough donors.");
             }
-
-            teams[missindex].size = teams[missindex].members.size();
-
-            write_line("Swapped a leader from Team " + to_string(donorindex + 1) + " to Team " + to_string(missindex + 1));
-            fixed = true;
-            break;
-        }
-
-        if (!fixed)
-        {
-            write_line("Could not find a leader swap for Team " + to_string(missindex + 1) + ". Not enough donors.");
         }
     }
 }
@@ -293,19 +330,135 @@ void recompute_team_stats(team &t)
     t.total_score = 0;
     // update size to number of members
     t.size = t.members.size();
-    // reset leader boolean
+    // reset leader boolean and count
     t.hasLeader = false;
+    t.leaders = 0;
+    for (int l = 0; l < SKILL_LANES; l++)
+    {
+        t.skill_totals[l] = 0;
+    }
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        t.role_counts[r] = 0;
+    }
+    for (int c = 0; c < MAX_CATEGORIES; c++)
+    {
+        for (int v = 0; v < MAX_CATEGORY_VALUES; v++)
+        {
+            t.category_counts[c][v] = 0;
+        }
+    }
+    for (int slot = 0; slot < MAX_SLOTS; slot++)
+    {
+        t.slot_counts[slot] = 0;
+    }
 
     // loop through all memebers to calculate totals
     for (int i = 0; i < t.members.size(); i++)
     {
         // sum all members score
         t.total_score += t.members[i].student_score;
+        apply_skill_lanes(t, t.members[i], 1);
+        apply_roles(t, t.members[i].roles, 1);
+        apply_categories(t, t.members[i], 1);
+        apply_availability(t, t.members[i].availability, 1);
 
         // if any member qualifies as a leader, then this will update the leader status of team to true
         if (t.members[i].leadership >= LEADER_THRESHOLD)
         {
             t.hasLeader = true;
+            t.leaders++;
         }
     }
+}
+
+/**
+ * add a student to a team and update its stats in O(1)
+ */
+void add_member_to_team(team &t, const student &s)
+{
+    t.members.push_back(s);
+    t.size = t.members.size();
+    t.total_score += s.student_score;
+    apply_skill_lanes(t, s, 1);
+    apply_roles(t, s.roles, 1);
+    apply_categories(t, s, 1);
+    apply_availability(t, s.availability, 1);
+
+    if (s.leadership >= LEADER_THRESHOLD)
+    {
+        t.leaders++;
+        t.hasLeader = true;
+    }
+}
+
+/**
+ * remove the member at idx and update the team's stats in O(1). the last member takes the
+ * removed member's place, so other members' positions can change
+ */
+student remove_member_at(team &t, int idx)
+{
+    student removed = t.members[idx];
+
+    if (idx != t.members.size() - 1)
+    {
+        t.members[idx] = t.members.back();
+    }
+    t.members.pop_back();
+
+    t.size = t.members.size();
+    t.total_score -= removed.student_score;
+    apply_skill_lanes(t, removed, -1);
+    apply_roles(t, removed.roles, -1);
+    apply_categories(t, removed, -1);
+    apply_availability(t, removed.availability, -1);
+
+    if (removed.leadership >= LEADER_THRESHOLD)
+    {
+        t.leaders--;
+        t.hasLeader = (t.leaders > 0);
+    }
+
+    return removed;
+}
+
+/**
+ * swap two members between teams and fix up the totals and leader counts without rescanning
+ */
+void swap_members(team &a, int ia, team &b, int ib)
+{
+    student &sa = a.members[ia];
+    student &sb = b.members[ib];
+
+    long long d = sb.student_score - sa.student_score;
+    int leader_a = (sa.leadership >= LEADER_THRESHOLD);
+    int leader_b = (sb.leadership >= LEADER_THRESHOLD);
+
+    a.total_score += d;
+    b.total_score -= d;
+    a.leaders += leader_b - leader_a;
+    b.leaders += leader_a - leader_b;
+    a.hasLeader = (a.leaders > 0);
+    b.hasLeader = (b.leaders > 0);
+
+    apply_skill_lanes(a, sa, -1);
+    apply_skill_lanes(a, sb, 1);
+    apply_skill_lanes(b, sb, -1);
+    apply_skill_lanes(b, sa, 1);
+    apply_roles(a, sa.roles, -1);
+    apply_roles(a, sb.roles, 1);
+    apply_roles(b, sb.roles, -1);
+    apply_roles(b, sa.roles, 1);
+    apply_categories(a, sa, -1);
+    apply_categories(a, sb, 1);
+    apply_categories(b, sb, -1);
+    apply_categories(b, sa, 1);
+    apply_availability(a, sa.availability & ~sb.availability, -1);
+    apply_availability(a, sb.availability & ~sa.availability, 1);
+    apply_availability(b, sb.availability & ~sa.availability, -1);
+    apply_availability(b, sa.availability & ~sb.availability, 1);
+
+    student temp = sa;
+    sa = sb;
+    sb = temp;
 }
\ No newline at end of file
@@ -1,6 +1,9 @@
 // including relavent libraries
 #pragma once
 #include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include "availability.h"
 #include <vector>
 #include <sstream>
 
@@ -13,13 +16,185 @@ using std::vector;
 int choose_best_team_index(const vector<team> &teams);
 
 /**
- * Allocate students into num_teams using the algorithm
+ * Allocate students into num_teams using the algorithm. Pinned students are placed first and
+ * nobody joins a team holding someone they must be kept apart from (when cs is given).
+ * Categorical columns are then evened out with balance_categories, and teams short of common
+ * meeting slots get a try with repair_availability, both weighing their swaps by mode.
  */
-vector<team> allocate_teams(vector<student> students, int num_teams);
+vector<team> allocate_teams(const vector<student> &students, int num_teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
 
 /**
- * Ensure every team has at least one leader (leadership >= leader_threshold)
+ * indices of students from highest to lowest score (ties keep file order). one order can be
+ * shared by any number of allocations of the same cohort
  */
-void ensure_leader_present(vector<team> &teams);
+vector<int> order_by_score(const vector<student> &students);
 
-void recompute_team_stats(team &t);
\ No newline at end of file
+/**
+ * the greedy allocation over a precomputed order, O(n log k). students is only read, and nothing
+ * is printed, so several of these can run on the same cohort at once
+ */
+vector<team> allocate_teams_in_order(const vector<student> &students, const vector<int> &order, int num_teams, const constraint_store *cs = nullptr);
+
+/**
+ * Ensure every team covers every role (the leader and any extra rules in roles.h), swapping a member
+ * in from a team that has that role twice without uncovering anything else
+ */
+void ensure_leader_present(vector<team> &teams, bool verbose = true, const constraint_store *cs = nullptr);
+
+/**
+ * a student's six skills in lane order (the order of skill_index), the padding lanes are 0
+ */
+inline void student_skill_lanes(const student &s, int lanes[SKILL_LANES])
+{
+    lanes[0] = s.leadership;
+    lanes[1] = s.frontend;
+    lanes[2] = s.backend;
+    lanes[3] = s.security;
+    lanes[4] = s.ui;
+    lanes[5] = s.english;
+    lanes[6] = 0;
+    lanes[7] = 0;
+}
+
+/**
+ * add (sign 1) or take away (sign -1) a student's skills from a team's skill totals
+ */
+inline void apply_skill_lanes(team &t, const student &s, int sign)
+{
+    int lanes[SKILL_LANES];
+    student_skill_lanes(s, lanes);
+    for (int l = 0; l < SKILL_LANES; l++)
+    {
+        t.skill_totals[l] += sign * lanes[l];
+    }
+}
+
+/**
+ * add (sign 1) or take away (sign -1) a role mask from a team's role counts
+ */
+inline void apply_roles(team &t, unsigned roles, int sign)
+{
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        if ((roles >> r) & 1u)
+        {
+            t.role_counts[r] += sign;
+        }
+    }
+}
+
+/**
+ * add (sign 1) or take away (sign -1) a student's category values from a team's counts
+ * (unused columns all hold code 0, so there's no need to know how many are active)
+ */
+inline void apply_categories(team &t, const student &s, int sign)
+{
+    for (int c = 0; c < MAX_CATEGORIES; c++)
+    {
+        t.category_counts[c][s.category[c]] += sign;
+    }
+}
+
+/**
+ * add (sign 1) or take away (sign -1) an availability mask from a team's slot counts.
+ * only the grid's slots are counted, so without an availability column this does nothing
+ */
+inline void apply_availability(team &t, unsigned long long mask, int sign)
+{
+    for (unsigned long long bits = mask & availability_slot_mask(); bits != 0; bits &= bits - 1)
+    {
+        t.slot_counts[__builtin_ctzll(bits)] += sign;
+    }
+}
+
+/**
+ * slots (of the grid) exactly count members are free in
+ */
+inline unsigned long long slots_with_count(const team &t, int count)
+{
+    unsigned long long mask = 0;
+    for (unsigned long long bits = availability_slot_mask(); bits != 0; bits &= bits - 1)
+    {
+        int slot = __builtin_ctzll(bits);
+        mask |= (unsigned long long)(t.slot_counts[slot] == count) << slot;
+    }
+    return mask;
+}
+
+/**
+ * slots every member is free in (the AND of the members' masks, read off the counts)
+ */
+inline unsigned long long team_common_slots(const team &t)
+{
+    return slots_with_count(t, t.members.size());
+}
+
+/**
+ * common slots after a member free in out_slots leaves and one free in in_slots joins. common is
+ * where everybody is free, near is where everybody but one is (see coverage_after_swap for roles)
+ */
+inline unsigned long long common_after_swap(unsigned long long common, unsigned long long near, unsigned long long out_slots, unsigned long long in_slots)
+{
+    return (common & ~(out_slots & ~in_slots)) | (near & in_slots & ~out_slots);
+}
+
+/**
+ * roles at least one member covers
+ */
+inline unsigned team_coverage(const team &t)
+{
+    unsigned mask = 0;
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        if (t.role_counts[r] > 0)
+        {
+            mask |= (1u << r);
+        }
+    }
+    return mask;
+}
+
+/**
+ * roles exactly one member covers (losing that member uncovers them)
+ */
+inline unsigned team_sole_roles(const team &t)
+{
+    unsigned mask = 0;
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        if (t.role_counts[r] == 1)
+        {
+            mask |= (1u << r);
+        }
+    }
+    return mask;
+}
+
+/**
+ * a team's coverage after a member with out_roles leaves and one with in_roles joins, in a few bit operations
+ */
+inline unsigned coverage_after_swap(unsigned cover, unsigned sole, unsigned out_roles, unsigned in_roles)
+{
+    return (cover & ~(sole & out_roles & ~in_roles)) | in_roles;
+}
+
+/**
+ * recalculate a team's total_score, size, leaders, hasLeader, skill totals, role, category and slot counts from its members
+ */
+void recompute_team_stats(team &t);
+
+/**
+ * add a student to a team, updating its stats in O(1)
+ */
+void add_member_to_team(team &t, const student &s);
+
+/**
+ * remove (and return) the member at idx, updating the team's stats in O(1).
+ * the last member is moved into the gap, so member order is not kept
+ */
+student remove_member_at(team &t, int idx);
+
+/**
+ * swap member ia of team a with member ib of team b, updating both teams' stats in O(1)
+ */
+void swap_members(team &a, int ia, team &b, int ib);
\ No newline at end of file
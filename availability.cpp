@@ -0,0 +1,69 @@
+// including relevant libraries
+#include "availability.h"
+
+/**
+ * width of the current grid, shared by every loader
+ */
+static int &grid_slots()
+{
+    static int slots = 0;
+    return slots;
+}
+
+int availability_slots()
+{
+    return grid_slots();
+}
+
+void set_availability_slots(int slots)
+{
+    grid_slots() = (slots < 0) ? 0 : (slots > MAX_SLOTS) ? MAX_SLOTS : slots;
+}
+
+unsigned long long availability_slot_mask()
+{
+    int slots = grid_slots();
+    return (slots >= MAX_SLOTS) ? ~0ULL : ((1ULL << slots) - 1);
+}
+
+int availability_target()
+{
+    int slots = grid_slots();
+    return (slots < AVAILABILITY_TARGET_SLOTS) ? slots : AVAILABILITY_TARGET_SLOTS;
+}
+
+/**
+ * walk the cell once, every slot character moves on to the next bit
+ */
+int parse_availability_cell(const char *begin, const char *end, unsigned long long &mask)
+{
+    unsigned long long bits = 0;
+    int slots = 0;
+
+    for (const char *p = begin; p < end; p++)
+    {
+        char c = *p;
+        bool free = (c == '1' || c == 'x' || c == 'X' || c == 'y' || c == 'Y');
+        bool busy = (c == '0' || c == '.' || c == '-' || c == 'n' || c == 'N');
+
+        if (!free && !busy)
+        {
+            continue;
+        }
+        if (slots < MAX_SLOTS && free)
+        {
+            bits |= (1ULL << slots);
+        }
+        slots++;
+    }
+
+    // blank, so nothing is known and nothing is ruled out
+    if (slots == 0)
+    {
+        mask = ~0ULL;
+        return 0;
+    }
+
+    mask = bits;
+    return (slots > MAX_SLOTS) ? MAX_SLOTS : slots;
+}
@@ -0,0 +1,47 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+
+// a team should share at least this many weekly slots to be able to meet
+const int AVAILABILITY_TARGET_SLOTS = 3;
+
+// a penalty for each common slot a team is short of the target (in variance units of whole points)
+const long long AVAILABILITY_PENALTY = 300;
+
+/**
+ * Slots in the loaded cohort's availability grid, 0 when the csv has no availability column
+ * (then the objective ignores availability altogether).
+ */
+int availability_slots();
+
+/**
+ * Set by the loaders once they know how wide the grid is (at most MAX_SLOTS).
+ */
+void set_availability_slots(int slots);
+
+/**
+ * The low availability_slots() bits, the only bits common slots are counted over.
+ */
+unsigned long long availability_slot_mask();
+
+/**
+ * Common slots a team should have: AVAILABILITY_TARGET_SLOTS, or fewer if the grid is smaller.
+ */
+int availability_target();
+
+/**
+ * Read an availability cell, one character per slot: 1/x/y free, 0/./-/n busy, anything else
+ * (spaces, ; or |) just separates days. A blank cell leaves the student free in every slot.
+ *
+ * @returns the number of slots in the cell (slots past MAX_SLOTS are ignored)
+ */
+int parse_availability_cell(const char *begin, const char *end, unsigned long long &mask);
+
+/**
+ * how many common slots a team is short of the target
+ */
+inline int slots_short(unsigned long long common, unsigned long long slot_mask, int target)
+{
+    int free = __builtin_popcountll(common & slot_mask);
+    return (free < target) ? target - free : 0;
+}
@@ -0,0 +1,163 @@
+// including relevant libraries
+#include "categories.h"
+#include "splashkit.h"
+#include <cctype>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * the active columns, shared by every loader
+ */
+static vector<category_column> &active_columns()
+{
+    static vector<category_column> columns;
+    return columns;
+}
+
+const vector<category_column> &category_columns()
+{
+    return active_columns();
+}
+
+int category_count()
+{
+    return active_columns().size();
+}
+
+void use_category_columns(const vector<string> &names)
+{
+    vector<category_column> &columns = active_columns();
+
+    bool same = (names.size() == columns.size());
+    for (int c = 0; same && c < names.size(); c++)
+    {
+        same = (names[c] == columns[c].name);
+    }
+
+    if (same)
+    {
+        return;
+    }
+
+    columns.clear();
+    for (int c = 0; c < names.size(); c++)
+    {
+        if (c == MAX_CATEGORIES)
+        {
+            write_line("Only " + to_string(MAX_CATEGORIES) + " category columns are supported, ignoring the rest.");
+            break;
+        }
+        columns.push_back({names[c], {}});
+    }
+}
+
+/**
+ * look for "category" inside brackets, the rest of the header (trimmed) is the column name
+ */
+bool is_category_header(const char *begin, const char *end, string &name)
+{
+    name.clear();
+    string bracketed;
+    bool marked = false;
+    int depth = 0;
+
+    for (const char *p = begin; p < end; p++)
+    {
+        char c = *p;
+        if (c == '(' || c == '[')
+        {
+            depth++;
+            bracketed.clear();
+        }
+        else if ((c == ')' || c == ']') && depth > 0)
+        {
+            depth--;
+            marked = marked || (bracketed == "category");
+        }
+        else if (depth > 0)
+        {
+            if (std::isalpha((unsigned char)c))
+            {
+                bracketed.push_back(std::tolower((unsigned char)c));
+            }
+        }
+        else if (c != '"')
+        {
+            name.push_back(c);
+        }
+    }
+
+    // trim what's left of the header
+    int from = 0;
+    int to = name.size();
+    while (from < to && std::isspace((unsigned char)name[from]))
+    {
+        from++;
+    }
+    while (to > from && std::isspace((unsigned char)name[to - 1]))
+    {
+        to--;
+    }
+    name = name.substr(from, to - from);
+
+    return marked;
+}
+
+/**
+ * linear search, columns like programme or campus only have a handful of values
+ */
+int intern_category_value(category_column &column, const char *begin, const char *end, int limit)
+{
+    size_t length = end - begin;
+    for (int v = 0; v < column.values.size(); v++)
+    {
+        const string &value = column.values[v];
+        if (value.size() == length && value.compare(0, length, begin, length) == 0)
+        {
+            return v;
+        }
+    }
+
+    if (column.values.size() >= limit)
+    {
+        return limit - 1;
+    }
+
+    column.values.push_back(string(begin, end));
+    return column.values.size() - 1;
+}
+
+/**
+ * build a local code -> active code table per column, then rewrite the students with it
+ */
+void merge_category_codes(vector<student> &students, size_t from, size_t to, const vector<category_column> &local)
+{
+    vector<category_column> &columns = active_columns();
+
+    for (int c = 0; c < columns.size() && c < local.size(); c++)
+    {
+        category_column &column = columns[c];
+        unsigned char remap[256] = {0};
+        bool folded = false;
+
+        for (int v = 0; v < local[c].values.size() && v < 256; v++)
+        {
+            const string &value = local[c].values[v];
+            int code = intern_category_value(column, value.data(), value.data() + value.size(), MAX_CATEGORY_VALUES);
+            folded = folded || (column.values[code] != value);
+            remap[v] = code;
+        }
+
+        if (folded)
+        {
+            write_line("Column " + column.name + " has more than " + to_string(MAX_CATEGORY_VALUES) + " values, the rest are counted as " + column.values.back() + ".");
+        }
+
+        for (size_t i = from; i < to; i++)
+        {
+            students[i].category[c] = remap[students[i].category[c]];
+        }
+    }
+}
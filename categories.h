@@ -0,0 +1,52 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+
+using std::vector;
+
+// weight of the category term in compute_balance_metric, in variance units of whole points.
+// a category value spread with a variance of 1 student per team costs as much as 10 points of score variance
+const long long CATEGORY_PENALTY = 10;
+
+// one categorical column and the value behind every code
+struct category_column
+{
+    std::string name;
+    vector<std::string> values; // code -> value, in order of first appearance
+};
+
+/**
+ * The categorical columns of the loaded cohort, the csv headers marked "(category)".
+ */
+const vector<category_column> &category_columns();
+
+/**
+ * Number of active categorical columns (0 when the csv has none, then nothing is spent on them).
+ */
+int category_count();
+
+/**
+ * Make these the active columns (at most MAX_CATEGORIES). If the names match the current ones the codes
+ * are kept, so a reload of the same file lines up with the students already in teams.
+ */
+void use_category_columns(const vector<std::string> &names);
+
+/**
+ * true for a header marked as categorical, "Campus (category)" or "Campus [category]".
+ * name is set to the header without the marker.
+ */
+bool is_category_header(const char *begin, const char *end, std::string &name);
+
+/**
+ * The code of a value in a column, adding it if it's new. Once the column holds limit values,
+ * every new value shares the last code.
+ */
+int intern_category_value(category_column &column, const char *begin, const char *end, int limit);
+
+/**
+ * Move the codes of students[from, to) out of a private dictionary (one csv chunk, a snapshot)
+ * and into the active columns. Column c of local has to be column c of the active set.
+ */
+void merge_category_codes(vector<student> &students, size_t from, size_t to, const vector<category_column> &local);
@@ -0,0 +1,497 @@
+// including relevant libraries
+#include "cohort_sync.h"
+#include "allocator.h"
+#include "incremental.h"
+#include "scoring.h"
+#include "roles.h"
+#include "splashkit.h"
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * true if two rows have the same skills, category values and availability (names are compared by the caller)
+ */
+static bool same_fields(const student &a, const student &b)
+{
+    bool same = a.leadership == b.leadership && a.frontend == b.frontend && a.backend == b.backend &&
+                a.security == b.security && a.ui == b.ui && a.english == b.english && a.availability == b.availability;
+    for (int c = 0; same && c < MAX_CATEGORIES; c++)
+    {
+        same = (a.category[c] == b.category[c]);
+    }
+    return same;
+}
+
+/**
+ * where each member of the changed teams sits now, then forget the changes
+ */
+static void index_changed_teams(cohort_index &ix, const vector<team> &teams)
+{
+    for (int i = 0; i < ix.roster.changed.size(); i++)
+    {
+        int t = ix.roster.changed[i];
+        for (int m = 0; m < teams[t].members.size(); m++)
+        {
+            int id = teams[t].members[m].id;
+            if (id >= 0 && id < ix.team_of.size())
+            {
+                ix.team_of[id] = t;
+                ix.slot_of[id] = m;
+            }
+        }
+    }
+    ix.roster.changed.clear();
+}
+
+/**
+ * index the cohort and begin its roster (see cohort_sync.h)
+ */
+void build_cohort_index(cohort_index &ix, const vector<student> &students, const vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    ix.ids_by_name.clear();
+    for (int i = 0; i < students.size(); i++)
+    {
+        ix.ids_by_name[students[i].name].push_back(i);
+    }
+
+    ix.team_of.assign(students.size(), -1);
+    ix.slot_of.assign(students.size(), -1);
+    ix.withdrawn.resize(students.size(), false);
+
+    begin_roster(ix.roster, teams, 0, cs, mode);
+    for (int t = 0; t < teams.size(); t++)
+    {
+        ix.roster.changed.push_back(t);
+    }
+    index_changed_teams(ix, teams);
+
+    ix.ready = true;
+}
+
+void refresh_cohort_team(cohort_index &ix, const vector<team> &teams, int t)
+{
+    if (!ix.ready)
+    {
+        return;
+    }
+
+    refresh_roster_team(ix.roster, teams, t);
+    index_changed_teams(ix, teams);
+}
+
+/**
+ * score a row that is new or changed (unchanged rows keep the score they already have)
+ */
+static void score_row(student &s)
+{
+    s.student_score = compute_student_score_rubric(s, default_rubric());
+    s.roles = compute_role_mask(s);
+}
+
+/**
+ * give a kept row the new values of its fresh copy, and its team the difference
+ */
+static void edit_row(vector<student> &students, vector<team> &teams, cohort_index &ix, int id, student &row)
+{
+    score_row(row);
+    row.id = id;
+
+    int t = ix.team_of[id];
+    if (t != -1)
+    {
+        team &tm = teams[t];
+        student &member = tm.members[ix.slot_of[id]];
+
+        // swap the old copy's stats out for the new ones
+        tm.total_score += row.student_score - member.student_score;
+        tm.leaders += (row.leadership >= LEADER_THRESHOLD) - (member.leadership >= LEADER_THRESHOLD);
+        tm.hasLeader = (tm.leaders > 0);
+        apply_skill_lanes(tm, member, -1);
+        apply_skill_lanes(tm, row, 1);
+        apply_roles(tm, member.roles, -1);
+        apply_roles(tm, row.roles, 1);
+        apply_categories(tm, member, -1);
+        apply_categories(tm, row, 1);
+        apply_availability(tm, member.availability, -1);
+        apply_availability(tm, row.availability, 1);
+        ix.roster.total_sum += row.student_score - member.student_score;
+
+        float x = member.x;
+        float y = member.y;
+        bool selected = member.selected;
+        member = row;
+        member.x = x;
+        member.y = y;
+        member.selected = selected;
+        ix.roster.changed.push_back(t);
+    }
+
+    students[id] = std::move(row);
+}
+
+/**
+ * apply a reload to the current allocation (see cohort_sync.h)
+ */
+cohort_diff_summary apply_cohort_changes(vector<student> &students, vector<team> &teams, vector<student> &fresh, cohort_index &ix, constraint_store *cs, balance_mode mode)
+{
+    cohort_diff_summary summary = {0, 0, 0, 0, false};
+
+    if (!ix.ready || ix.roster.mode != mode)
+    {
+        build_cohort_index(ix, students, teams, cs, mode);
+    }
+
+    // most reloads only touch a few rows, so the rows that kept their place at both ends are paired up
+    // directly and only the middle in between is matched by name
+    int old_n = students.size();
+    int new_n = fresh.size();
+    int head = 0;
+    while (head < old_n && head < new_n && students[head].name == fresh[head].name)
+    {
+        head++;
+    }
+    int tail = 0;
+    while (tail < old_n - head && tail < new_n - head && students[old_n - 1 - tail].name == fresh[new_n - 1 - tail].name)
+    {
+        tail++;
+    }
+    int shift = new_n - old_n;
+    int old_mid = old_n - tail - head;
+    int new_mid = new_n - tail - head;
+
+    // middle rows: old row -> new row (-1 = removed) and new row -> old row (-1 = added),
+    // duplicate names pair up in file order
+    vector<int> moved_to(old_mid, -1);
+    vector<int> came_from(new_mid, -1);
+    if (old_mid > 0 && new_mid > 0)
+    {
+        std::unordered_map<string, vector<int>> by_name;
+        for (int j = new_mid - 1; j >= 0; j--)
+        {
+            by_name[fresh[head + j].name].push_back(j);
+        }
+        for (int i = 0; i < old_mid; i++)
+        {
+            auto found = by_name.find(students[head + i].name);
+            if (found != by_name.end() && !found->second.empty())
+            {
+                moved_to[i] = found->second.back();
+                came_from[moved_to[i]] = i;
+                found->second.pop_back();
+            }
+        }
+    }
+
+    // removed rows leave their team first, while every member still has its old id
+    vector<int> shrunk;
+    vector<int> shrunk_by;
+    vector<unsigned> removed_roles;
+    std::unordered_map<int, int> shrunk_at;
+    for (int i = 0; i < old_mid; i++)
+    {
+        if (moved_to[i] != -1)
+        {
+            continue;
+        }
+
+        int id = head + i;
+        int t = ix.team_of[id];
+        summary.removed++;
+        if (ix.withdrawn[id])
+        {
+            ix.withdrawn_count--;
+        }
+        if (t == -1)
+        {
+            continue;
+        }
+
+        // the last member moves into the gap
+        int slot = ix.slot_of[id];
+        student gone = remove_member_at(teams[t], slot);
+        if (slot < teams[t].members.size())
+        {
+            ix.slot_of[teams[t].members[slot].id] = slot;
+        }
+        ix.roster.students--;
+        ix.roster.total_sum -= gone.student_score;
+
+        auto at = shrunk_at.find(t);
+        if (at == shrunk_at.end())
+        {
+            at = shrunk_at.emplace(t, shrunk.size()).first;
+            shrunk.push_back(t);
+            shrunk_by.push_back(0);
+            removed_roles.push_back(0);
+        }
+        shrunk_by[at->second]++;
+        removed_roles[at->second] |= gone.roles;
+    }
+
+    // kept rows are compared field by field, only the edited ones are rescored and patched into their team
+    for (int i = 0; i < old_n; i++)
+    {
+        int j = -1;
+        if (i < head)
+        {
+            j = i;
+        }
+        else if (i >= old_n - tail)
+        {
+            j = i + shift;
+        }
+        else if (moved_to[i - head] != -1)
+        {
+            j = head + moved_to[i - head];
+        }
+
+        if (j == -1)
+        {
+            continue;
+        }
+        if (same_fields(students[i], fresh[j]))
+        {
+            summary.unchanged++;
+        }
+        else
+        {
+            edit_row(students, teams, ix, i, fresh[j]);
+            summary.edited++;
+        }
+    }
+
+    // ids only move in the middle, and in the tail when the count changed
+    if (old_mid > 0 || new_mid > 0)
+    {
+        // every name whose ids move is remapped once, then the added rows join their names.
+        // names on several rows are ticked off in remapped, a name on one row (the usual case) needs no tick
+        // unless it is what a duplicate shrank to
+        std::unordered_set<string> remapped;
+        int moved_end = (shift != 0) ? old_n : old_n - tail;
+        for (int i = head; i < moved_end; i++)
+        {
+            vector<int> &ids = ix.ids_by_name[students[i].name];
+            bool done = (ids.size() == 1) ? (!remapped.empty() && remapped.count(students[i].name) > 0) : !remapped.insert(students[i].name).second;
+            if (done)
+            {
+                continue;
+            }
+
+            int kept = 0;
+            for (int e = 0; e < ids.size(); e++)
+            {
+                int id = ids[e];
+                if (id >= head && id < old_n - tail)
+                {
+                    id = (moved_to[id - head] == -1) ? -1 : head + moved_to[id - head];
+                }
+                else if (id >= old_n - tail)
+                {
+                    id += shift;
+                }
+                if (id != -1)
+                {
+                    ids[kept++] = id;
+                }
+            }
+            ids.resize(kept);
+        }
+        for (int j = 0; j < new_mid; j++)
+        {
+            if (came_from[j] == -1)
+            {
+                vector<int> &ids = ix.ids_by_name[fresh[head + j].name];
+                ids.push_back(head + j);
+                std::sort(ids.begin(), ids.end());
+            }
+        }
+
+        // splice the new middle in, rows and their index entries alike
+        vector<student> rows(new_mid);
+        vector<int> team_of(new_mid, -1);
+        vector<int> slot_of(new_mid, -1);
+        vector<bool> withdrawn(new_mid, false);
+        for (int j = 0; j < new_mid; j++)
+        {
+            int i = came_from[j];
+            if (i == -1)
+            {
+                rows[j] = std::move(fresh[head + j]);
+                score_row(rows[j]);
+                continue;
+            }
+            rows[j] = std::move(students[head + i]);
+            team_of[j] = ix.team_of[head + i];
+            slot_of[j] = ix.slot_of[head + i];
+            withdrawn[j] = ix.withdrawn[head + i];
+        }
+
+        students.erase(students.begin() + head, students.begin() + head + old_mid);
+        students.insert(students.begin() + head, std::make_move_iterator(rows.begin()), std::make_move_iterator(rows.end()));
+        ix.team_of.erase(ix.team_of.begin() + head, ix.team_of.begin() + head + old_mid);
+        ix.team_of.insert(ix.team_of.begin() + head, team_of.begin(), team_of.end());
+        ix.slot_of.erase(ix.slot_of.begin() + head, ix.slot_of.begin() + head + old_mid);
+        ix.slot_of.insert(ix.slot_of.begin() + head, slot_of.begin(), slot_of.end());
+        ix.withdrawn.erase(ix.withdrawn.begin() + head, ix.withdrawn.begin() + head + old_mid);
+        ix.withdrawn.insert(ix.withdrawn.begin() + head, withdrawn.begin(), withdrawn.end());
+
+        // rows that moved, and team members that stand for them, take their new ids
+        int renumber_end = (shift != 0) ? new_n : head + new_mid;
+        for (int j = head; j < renumber_end; j++)
+        {
+            students[j].id = j;
+            if (ix.team_of[j] != -1)
+            {
+                teams[ix.team_of[j]].members[ix.slot_of[j]].id = j;
+            }
+        }
+
+        // rules are by name, so they follow the rows before the repairs move anyone
+        summary.ids_moved = true;
+        if (cs != nullptr)
+        {
+            resolve_constraints(*cs, students, teams.size());
+        }
+    }
+    ix.roster.cs = has_constraints(cs) ? cs : nullptr;
+
+    if (!teams.empty())
+    {
+        // teams with edited or removed members are re-sorted in the heaps before any repair reads them
+        vector<int> touched;
+        touched.swap(ix.roster.changed);
+        touched.insert(touched.end(), shrunk.begin(), shrunk.end());
+        for (int i = 0; i < touched.size(); i++)
+        {
+            refresh_roster_team(ix.roster, teams, touched[i]);
+        }
+
+        // repair only once every member carries its new id. one repair per removed member, like that many
+        // withdraws would do (a repair pulls back at most one student, a team down four needs three)
+        for (int i = 0; i < shrunk.size(); i++)
+        {
+            unsigned lost_roles = removed_roles[i] & ~team_coverage(teams[shrunk[i]]);
+            for (int r = 0; r < shrunk_by[i]; r++)
+            {
+                repair_after_removal(teams, ix.roster, shrunk[i], r == 0 ? lost_roles : 0, DEFAULT_REPAIR_BUDGET);
+            }
+        }
+
+        // new rows are late enrolments, they go through the incremental insertion path
+        for (int j = 0; j < new_mid; j++)
+        {
+            if (came_from[j] == -1)
+            {
+                insert_student(teams, ix.roster, students[head + j], DEFAULT_REPAIR_BUDGET);
+                summary.added++;
+            }
+        }
+        index_changed_teams(ix, teams);
+    }
+    else
+    {
+        for (int j = 0; j < new_mid; j++)
+        {
+            summary.added += (came_from[j] == -1);
+        }
+    }
+
+    fresh.clear();
+
+    write_line("Reload: " + to_string(summary.added) + " added, " + to_string(summary.removed) + " removed, " + to_string(summary.edited) + " edited, " + to_string(summary.unchanged) + " unchanged.");
+    return summary;
+}
+
+/**
+ * drop one student from their team and leave their row as a tombstone (see cohort_sync.h)
+ */
+int withdraw_student(vector<student> &students, vector<team> &teams, cohort_index &ix, const string &name, const constraint_store *cs, balance_mode mode)
+{
+    if (!ix.ready || ix.roster.mode != mode)
+    {
+        build_cohort_index(ix, students, teams, cs, mode);
+    }
+
+    auto found = ix.ids_by_name.find(name);
+    if (found == ix.ids_by_name.end())
+    {
+        return -1;
+    }
+
+    for (int i = 0; i < found->second.size(); i++)
+    {
+        int id = found->second[i];
+        int t = ix.team_of[id];
+        if (t == -1)
+        {
+            continue;
+        }
+
+        remove_student(teams, ix.roster, t, ix.slot_of[id], DEFAULT_REPAIR_BUDGET);
+        ix.team_of[id] = -1;
+        ix.withdrawn[id] = true;
+        ix.withdrawn_count++;
+
+        // the member moved into the gap and whoever the repair moved get their new slots
+        index_changed_teams(ix, teams);
+
+        write_line("Withdrew " + name + " from Team " + to_string(t + 1) + ".");
+        return id;
+    }
+
+    return -1;
+}
+
+/**
+ * drop the tombstones and renumber (see cohort_sync.h)
+ */
+bool compact_withdrawn(vector<student> &students, vector<team> &teams, cohort_index &ix)
+{
+    if (ix.withdrawn_count == 0)
+    {
+        return false;
+    }
+
+    vector<int> new_id(students.size(), -1);
+    int kept = 0;
+    for (int i = 0; i < students.size(); i++)
+    {
+        if (i < ix.withdrawn.size() && ix.withdrawn[i])
+        {
+            continue;
+        }
+        if (kept != i)
+        {
+            students[kept] = std::move(students[i]);
+        }
+        students[kept].id = kept;
+        new_id[i] = kept;
+        kept++;
+    }
+    students.resize(kept);
+
+    for (int t = 0; t < teams.size(); t++)
+    {
+        for (int m = 0; m < teams[t].members.size(); m++)
+        {
+            int id = teams[t].members[m].id;
+            if (id >= 0 && id < new_id.size())
+            {
+                teams[t].members[m].id = new_id[id];
+            }
+        }
+    }
+
+    write_line("Dropped " + to_string(ix.withdrawn_count) + " withdrawn students from the cohort.");
+    ix.withdrawn.clear();
+    ix.withdrawn_count = 0;
+    ix.ready = false;
+    return true;
+}
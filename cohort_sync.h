@@ -0,0 +1,80 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include "incremental.h"
+#include <vector>
+#include <string>
+#include <unordered_map>
+
+using std::vector;
+
+// what a reload changed
+struct cohort_diff_summary
+{
+    int added;
+    int removed;
+    int edited;
+    int unchanged;
+    bool ids_moved; // a row was added, removed or moved, so whatever was resolved by id needs resolving again
+};
+
+/**
+ * where every student of the cohort sits, kept between withdraws and reloads next to a roster so
+ * neither searches the teams nor rebuilds the heaps. withdrawn rows stay in students as tombstones,
+ * so ids don't move and resolved constraints stay valid until compact_withdrawn drops them.
+ */
+struct cohort_index
+{
+    roster_state roster;
+    std::unordered_map<std::string, vector<int>> ids_by_name; // every id with that name, in file order
+    vector<int> team_of;    // per student id, -1 = not in a team
+    vector<int> slot_of;    // per student id, member index in team_of
+    vector<bool> withdrawn; // per student id, tombstone left by withdraw_student
+    int withdrawn_count = 0;
+    bool ready = false;     // false once the teams changed some other way (rebuilt on the next use)
+};
+
+/**
+ * Index students and teams and begin a roster over them, O(n + k). Tombstones are kept.
+ */
+void build_cohort_index(cohort_index &ix, const vector<student> &students, const vector<team> &teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Follow a change to team t made outside the index (a swap from the queue), O(team size + log k).
+ * Does nothing while the index isn't ready.
+ */
+void refresh_cohort_team(cohort_index &ix, const vector<team> &teams, int t);
+
+/**
+ * Bring an existing allocation up to date with a freshly loaded cohort, matching students by name.
+ * Unchanged students stay where they are, edited students are rescored in place, removed students
+ * leave their team (followed by a small local rebalance) and new students join the best team.
+ * Withdrawn rows that are still in the file stay withdrawn.
+ *
+ * Rows that kept their place at either end are compared in one pass, only the rows in between are
+ * matched by name. Only edited and new rows are scored (fresh may come unscored), and only their
+ * teams, the rows whose ids moved and the teams the repairs touch are updated, through ix.
+ * students ends up in fresh's order with fresh's values, fresh is used up.
+ * cs, if given, is resolved against students as they come in, and again against the new rows only
+ * if ids moved (an edit-only reload leaves it alone).
+ */
+cohort_diff_summary apply_cohort_changes(vector<student> &students, vector<team> &teams, vector<student> &fresh, cohort_index &ix, constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Withdraw one student (first match by name still in a team) and repair only around their team.
+ * Their row stays in students as a tombstone, so ids, cs and preference graphs stay valid. Costs a
+ * name lookup plus the repair, the index is only rebuilt if it isn't ready.
+ *
+ * @returns the withdrawn student's id, or -1 if nobody by that name is in a team
+ */
+int withdraw_student(vector<student> &students, vector<team> &teams, cohort_index &ix, const std::string &name, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Drop the tombstones from students and renumber ids (team members too) before anything that works on
+ * the whole cohort. O(n), and the index has to be rebuilt afterwards.
+ *
+ * @returns true if any row was dropped (so cs and preference graphs need resolving again)
+ */
+bool compact_withdrawn(vector<student> &students, vector<team> &teams, cohort_index &ix);
@@ -0,0 +1,313 @@
+// including relevant libraries
+#include "constraints.h"
+#include "io.h"
+#include "splashkit.h"
+#include <fstream>
+#include <unordered_map>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * split one sidecar line on commas (the sidecar never needs quoted fields)
+ */
+static vector<string> split_constraint_line(const string &line)
+{
+    vector<string> cells;
+    string cell;
+
+    for (int i = 0; i < line.size(); i++)
+    {
+        if (line[i] == ',')
+        {
+            cells.push_back(trim_string(cell));
+            cell.clear();
+        }
+        else
+        {
+            cell += line[i];
+        }
+    }
+    cells.push_back(trim_string(cell));
+
+    return cells;
+}
+
+/**
+ * read pins and apart rules from the sidecar csv
+ */
+bool load_constraints_csv(const string &filename, constraint_store &out)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    out.pins.clear();
+    out.apart.clear();
+
+    string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+        vector<string> cells = split_constraint_line(line);
+
+        if (cells.size() == 1 && cells[0].empty())
+        {
+            continue;
+        }
+
+        string kind = cells[0];
+        for (int i = 0; i < kind.size(); i++)
+        {
+            kind[i] = tolower((unsigned char)kind[i]);
+        }
+
+        if (kind == "pin" && cells.size() >= 3)
+        {
+            int team_number = safe_stoi(cells[2], 0);
+            if (team_number <= 0)
+            {
+                write_line("Constraints line " + to_string(line_number) + ": bad team number '" + cells[2] + "'.");
+                continue;
+            }
+            out.pins.push_back(std::make_pair(cells[1], team_number - 1));
+        }
+        else if (kind == "apart" && cells.size() >= 3)
+        {
+            out.apart.push_back(std::make_pair(cells[1], cells[2]));
+        }
+        else if (line_number > 1)
+        {
+            // line 1 is allowed to be a header
+            write_line("Constraints line " + to_string(line_number) + " ignored: " + line);
+        }
+    }
+
+    write_line("Loaded " + to_string(out.pins.size()) + " pins and " + to_string(out.apart.size()) + " apart rules from " + filename);
+    return true;
+}
+
+/**
+ * turn the named rules into per-id arrays for this cohort
+ */
+void resolve_constraints(constraint_store &cs, const vector<student> &students, int team_count)
+{
+    cs.pinned_team.assign(students.size(), -1);
+    cs.pin_ids.assign(cs.pins.size(), -1);
+    cs.slot.assign(students.size(), -1);
+    cs.conflicts.clear();
+    cs.words = 0;
+
+    std::unordered_map<string, int> by_name;
+    for (int i = students.size() - 1; i >= 0; i--)
+    {
+        by_name[students[i].name] = i;
+    }
+
+    for (int i = 0; i < cs.pins.size(); i++)
+    {
+        auto found = by_name.find(cs.pins[i].first);
+        if (found == by_name.end())
+        {
+            write_line("Pinned student not found: " + cs.pins[i].first);
+            continue;
+        }
+        cs.pinned_team[found->second] = cs.pins[i].second;
+        cs.pin_ids[i] = found->second;
+    }
+
+    if (team_count > 0)
+    {
+        limit_pins_to_teams(cs, team_count);
+    }
+
+    // give every student in an apart rule a compact slot first, so the rows can be sized
+    vector<std::pair<int, int>> pairs;
+    int slots = 0;
+    for (int i = 0; i < cs.apart.size(); i++)
+    {
+        auto a = by_name.find(cs.apart[i].first);
+        auto b = by_name.find(cs.apart[i].second);
+        if (a == by_name.end() || b == by_name.end() || a->second == b->second)
+        {
+            write_line("Apart rule skipped: " + cs.apart[i].first + ", " + cs.apart[i].second);
+            continue;
+        }
+
+        if (cs.slot[a->second] == -1)
+        {
+            cs.slot[a->second] = slots++;
+        }
+        if (cs.slot[b->second] == -1)
+        {
+            cs.slot[b->second] = slots++;
+        }
+        pairs.push_back(std::make_pair(cs.slot[a->second], cs.slot[b->second]));
+    }
+
+    cs.words = (slots + 63) / 64;
+    cs.conflicts.assign((size_t)slots * cs.words, 0);
+
+    // the graph is symmetric, set both directions
+    for (int i = 0; i < pairs.size(); i++)
+    {
+        int a = pairs[i].first;
+        int b = pairs[i].second;
+        cs.conflicts[(size_t)a * cs.words + b / 64] |= (1ULL << (b % 64));
+        cs.conflicts[(size_t)b * cs.words + a / 64] |= (1ULL << (a % 64));
+    }
+}
+
+/**
+ * forget pins nobody can honour with this many teams
+ */
+void limit_pins_to_teams(constraint_store &cs, int team_count)
+{
+    for (int i = 0; i < cs.pin_ids.size(); i++)
+    {
+        int id = cs.pin_ids[i];
+        if (id == -1 || cs.pins[i].second < team_count)
+        {
+            continue;
+        }
+
+        // a later pin of the same student may have won, only clear the one this pin set
+        if (cs.pinned_team[id] == cs.pins[i].second)
+        {
+            cs.pinned_team[id] = -1;
+        }
+        cs.pin_ids[i] = -1;
+        write_line("Pin of " + cs.pins[i].first + " to team " + to_string(cs.pins[i].second + 1) + " ignored, there are only " + to_string(team_count) + " teams.");
+    }
+}
+
+/**
+ * "cohort.csv" -> "cohort_constraints.csv"
+ */
+string constraints_path_for(const string &csv_path)
+{
+    string base = csv_path;
+    if (base.size() >= 4 && base.compare(base.size() - 4, 4, ".csv") == 0)
+    {
+        base.erase(base.size() - 4);
+    }
+    return base + "_constraints.csv";
+}
+
+/**
+ * any resolved pins or conflicts?
+ */
+bool has_constraints(const constraint_store *cs)
+{
+    if (cs == nullptr)
+    {
+        return false;
+    }
+    return cs->words > 0 || (!cs->pins.empty() && !cs->pinned_team.empty());
+}
+
+/**
+ * set the bit of every conflicted member in its team's row
+ */
+void build_team_masks(const constraint_store &cs, const vector<team> &teams, team_masks &masks)
+{
+    masks.words = cs.words;
+    masks.bits.assign((size_t)teams.size() * cs.words, 0);
+
+    for (int t = 0; t < teams.size(); t++)
+    {
+        for (int m = 0; m < teams[t].members.size(); m++)
+        {
+            mask_toggle(&cs, masks, t, teams[t].members[m]);
+        }
+    }
+}
+
+/**
+ * count broken rules in an allocation
+ */
+int count_constraint_violations(const constraint_store *cs, const vector<team> &teams)
+{
+    if (!has_constraints(cs))
+    {
+        return 0;
+    }
+
+    team_masks masks;
+    build_team_masks(*cs, teams, masks);
+
+    int violations = 0;
+    for (int t = 0; t < teams.size(); t++)
+    {
+        for (int m = 0; m < teams[t].members.size(); m++)
+        {
+            const student &s = teams[t].members[m];
+            int pin = pinned_team_of(cs, s);
+            if (pin != -1 && pin < teams.size() && pin != t)
+            {
+                violations++;
+            }
+
+            // each conflicting pair shows up from both sides, so count only the lower slot
+            int row = conflict_slot_of(cs, s);
+            if (row == -1)
+            {
+                continue;
+            }
+            for (int w = 0; w < cs->words; w++)
+            {
+                uint64_t both = cs->conflicts[(size_t)row * cs->words + w] & masks.bits[(size_t)t * masks.words + w];
+                while (both)
+                {
+                    int other = w * 64 + __builtin_ctzll(both);
+                    if (other > row)
+                    {
+                        violations++;
+                    }
+                    both &= both - 1;
+                }
+            }
+        }
+    }
+
+    return violations;
+}
+
+/**
+ * member-scan version of fits_mask for operations that move one student at a time
+ */
+bool fits_team(const constraint_store *cs, const vector<team> &teams, int team_index, const student &s, int leaving_idx)
+{
+    if (!has_constraints(cs))
+    {
+        return true;
+    }
+
+    int pin = pinned_team_of(cs, s);
+    if (pin != -1 && pin < teams.size() && pin != team_index)
+    {
+        return false;
+    }
+
+    int row = conflict_slot_of(cs, s);
+    if (row == -1)
+    {
+        return true;
+    }
+
+    const uint64_t *want = &cs->conflicts[(size_t)row * cs->words];
+    const team &t = teams[team_index];
+    for (int m = 0; m < t.members.size(); m++)
+    {
+        int other = conflict_slot_of(cs, t.members[m]);
+        if (m != leaving_idx && other != -1 && (want[other / 64] >> (other % 64)) & 1ULL)
+        {
+            return false;
+        }
+    }
+    return true;
+}
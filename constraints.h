@@ -0,0 +1,163 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+#include <utility>
+#include <cstdint>
+
+using std::vector;
+
+/**
+ * pinned students and pairs that must be kept apart.
+ * the rules are kept by name so they survive a reload, resolve_constraints turns them into
+ * per-student arrays for the current cohort (indexed by student id).
+ * only students that appear in an "apart" rule get a slot, so the conflict bitsets are
+ * (conflicted students / 64) words wide, not n / 64
+ */
+struct constraint_store
+{
+    vector<std::pair<std::string, int>> pins;           // name, team index (0-based)
+    vector<std::pair<std::string, std::string>> apart;  // names that can't share a team
+
+    vector<int> pinned_team;    // per student id, -1 = free to move
+    vector<int> pin_ids;        // per pin, the student id it resolved to (-1 = not found or dropped)
+    vector<int> slot;           // per student id, row in conflicts, -1 = no conflicts
+    int words = 0;              // 64-bit words per conflict row
+    vector<uint64_t> conflicts; // slot rows, bit j set = can't share a team with slot j
+};
+
+// which conflicted students are in each team, one row of words per team (built per engine run)
+struct team_masks
+{
+    int words = 0;
+    vector<uint64_t> bits;
+};
+
+/**
+ * Read a sidecar CSV with lines "pin,<name>,<team number>" and "apart,<name>,<name>".
+ * Team numbers start at 1 like on screen. A header line and blank lines are skipped.
+ *
+ * @returns false if the file couldn't be opened
+ */
+bool load_constraints_csv(const std::string &filename, constraint_store &out);
+
+/**
+ * Match the rules against a cohort (first student with each name), unknown names are reported and skipped.
+ * With team_count > 0, pins to a team past the last one are reported and dropped too (see limit_pins_to_teams).
+ */
+void resolve_constraints(constraint_store &cs, const vector<student> &students, int team_count = 0);
+
+/**
+ * Drop (and report once) every resolved pin to a team at or past team_count, so no engine has to decide
+ * what an unreachable pin means. O(pins).
+ */
+void limit_pins_to_teams(constraint_store &cs, int team_count);
+
+/**
+ * Sidecar name for a cohort file: "cohort.csv" -> "cohort_constraints.csv".
+ */
+std::string constraints_path_for(const std::string &csv_path);
+
+/**
+ * true if cs holds any resolved rule (engines skip all checks otherwise)
+ */
+bool has_constraints(const constraint_store *cs);
+
+/**
+ * Fill one mask row per team from its current members.
+ */
+void build_team_masks(const constraint_store &cs, const vector<team> &teams, team_masks &masks);
+
+/**
+ * Count pins on the wrong team and conflicting pairs sharing a team.
+ */
+int count_constraint_violations(const constraint_store *cs, const vector<team> &teams);
+
+/**
+ * Whether s can join team_index without breaking a rule, scanning the team's members (for one-off moves).
+ * leaving_idx is a member that leaves at the same time (-1 for none).
+ */
+bool fits_team(const constraint_store *cs, const vector<team> &teams, int team_index, const student &s, int leaving_idx);
+
+// the checks below sit inside the optimiser loops, so they are inline and only a few word operations
+
+/**
+ * pinned team of s, or -1
+ */
+inline int pinned_team_of(const constraint_store *cs, const student &s)
+{
+    if (cs == nullptr || s.id < 0 || s.id >= cs->pinned_team.size())
+    {
+        return -1;
+    }
+    return cs->pinned_team[s.id];
+}
+
+/**
+ * conflict slot of s, or -1
+ */
+inline int conflict_slot_of(const constraint_store *cs, const student &s)
+{
+    if (cs == nullptr || s.id < 0 || s.id >= cs->slot.size())
+    {
+        return -1;
+    }
+    return cs->slot[s.id];
+}
+
+/**
+ * true if s (not yet in team_index) could join it while leaving (already in it, or nullptr) goes
+ */
+inline bool fits_mask(const constraint_store *cs, const team_masks &masks, int team_index, const student &s, const student *leaving)
+{
+    int row = conflict_slot_of(cs, s);
+    if (row == -1)
+    {
+        return true;
+    }
+
+    const uint64_t *want = &cs->conflicts[(size_t)row * cs->words];
+    const uint64_t *have = &masks.bits[(size_t)team_index * masks.words];
+    int gone = (leaving == nullptr) ? -1 : conflict_slot_of(cs, *leaving);
+
+    for (int w = 0; w < cs->words; w++)
+    {
+        uint64_t present = have[w];
+        if (gone >= 0 && gone / 64 == w)
+        {
+            present &= ~(1ULL << (gone % 64));
+        }
+        if (want[w] & present)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * true if sa (in team a) and sb (in team b) can trade places
+ */
+inline bool swap_allowed(const constraint_store *cs, const team_masks &masks, int a, const student &sa, int b, const student &sb)
+{
+    int pin_a = pinned_team_of(cs, sa);
+    int pin_b = pinned_team_of(cs, sb);
+    if ((pin_a != -1 && pin_a != b) || (pin_b != -1 && pin_b != a))
+    {
+        return false;
+    }
+    return fits_mask(cs, masks, b, sa, &sb) && fits_mask(cs, masks, a, sb, &sa);
+}
+
+/**
+ * keep a team's mask row in step when s joins or leaves it
+ */
+inline void mask_toggle(const constraint_store *cs, team_masks &masks, int team_index, const student &s)
+{
+    int row = conflict_slot_of(cs, s);
+    if (row != -1)
+    {
+        masks.bits[(size_t)team_index * masks.words + row / 64] ^= (1ULL << (row % 64));
+    }
+}
@@ -0,0 +1,352 @@
+// including relevant libraries
+#include "exporter.h"
+#include "categories.h"
+#include "splashkit.h"
+#include <charconv>
+#include <cstring>
+
+using std::vector;
+using std::string;
+
+/**
+ * push whatever is in the buffer out to the file
+ */
+static void flush_writer(buffered_writer &w)
+{
+    if (w.used > 0)
+    {
+        std::fwrite(w.buffer.data(), 1, w.used, w.file);
+        w.used = 0;
+    }
+}
+
+/**
+ * make sure at least bytes are free in the buffer
+ */
+static void reserve_bytes(buffered_writer &w, size_t bytes)
+{
+    if (w.buffer.size() - w.used < bytes)
+    {
+        flush_writer(w);
+    }
+}
+
+/**
+ * open the file and allocate the buffer once
+ */
+bool open_writer(buffered_writer &w, const string &filename)
+{
+    w.file = std::fopen(filename.c_str(), "wb");
+    w.used = 0;
+
+    // error handling
+    if (w.file == nullptr)
+    {
+        return false;
+    }
+
+    w.buffer.resize(EXPORT_BUFFER_BYTES);
+    return true;
+}
+
+/**
+ * flush and close
+ */
+bool close_writer(buffered_writer &w)
+{
+    if (w.file == nullptr)
+    {
+        return false;
+    }
+
+    flush_writer(w);
+    bool ok = std::ferror(w.file) == 0;
+    ok = (std::fclose(w.file) == 0) && ok;
+    w.file = nullptr;
+    return ok;
+}
+
+/**
+ * append raw text, big pieces skip the buffer entirely
+ */
+void write_text(buffered_writer &w, const char *text, size_t length)
+{
+    if (length > w.buffer.size() / 2)
+    {
+        flush_writer(w);
+        std::fwrite(text, 1, length, w.file);
+        return;
+    }
+
+    reserve_bytes(w, length);
+    std::memcpy(w.buffer.data() + w.used, text, length);
+    w.used += length;
+}
+
+void write_text(buffered_writer &w, const char *text)
+{
+    write_text(w, text, std::strlen(text));
+}
+
+void write_text(buffered_writer &w, const string &text)
+{
+    write_text(w, text.data(), text.size());
+}
+
+/**
+ * append an integer straight into the buffer
+ */
+void write_int(buffered_writer &w, long long value)
+{
+    reserve_bytes(w, 24);
+    char *start = w.buffer.data() + w.used;
+    char *end = std::to_chars(start, start + 24, value).ptr;
+    w.used += end - start;
+}
+
+/**
+ * append a fixed point score with two decimals (same text as format_score)
+ */
+void write_score(buffered_writer &w, long long fixed_score)
+{
+    reserve_bytes(w, 32);
+
+    if (fixed_score < 0)
+    {
+        w.buffer[w.used++] = '-';
+        fixed_score = -fixed_score;
+    }
+
+    // hundredths are exact because SCORE_SCALE divides 100
+    long long hundredths = fixed_score * (100 / SCORE_SCALE);
+    write_int(w, hundredths / 100);
+
+    int frac = hundredths % 100;
+    w.buffer[w.used++] = '.';
+    w.buffer[w.used++] = '0' + frac / 10;
+    w.buffer[w.used++] = '0' + frac % 10;
+}
+
+/**
+ * append a csv field, quoting it if it needs quotes
+ */
+void write_csv_field(buffered_writer &w, const string &text)
+{
+    if (text.find_first_of(",\"\r\n") == string::npos)
+    {
+        write_text(w, text);
+        return;
+    }
+
+    write_text(w, "\"", 1);
+    for (int i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"')
+        {
+            write_text(w, "\"\"", 2);
+        }
+        else
+        {
+            write_text(w, &text[i], 1);
+        }
+    }
+    write_text(w, "\"", 1);
+}
+
+/**
+ * append a json string, escaping quotes, backslashes and control characters
+ */
+void write_json_string(buffered_writer &w, const string &text)
+{
+    static const char hex[] = "0123456789abcdef";
+    write_text(w, "\"", 1);
+
+    for (int i = 0; i < text.size(); i++)
+    {
+        unsigned char c = text[i];
+        if (c == '"' || c == '\\')
+        {
+            char escaped[2] = {'\\', (char)c};
+            write_text(w, escaped, 2);
+        }
+        else if (c < 0x20)
+        {
+            char escaped[6] = {'\\', 'u', '0', '0', hex[c >> 4], hex[c & 15]};
+            write_text(w, escaped, 6);
+        }
+        else
+        {
+            write_text(w, (const char *)&c, 1);
+        }
+    }
+
+    write_text(w, "\"", 1);
+}
+
+/**
+ * export to csv, one row per member
+ */
+bool export_teams_csv(const string &filename, const vector<team> &teams)
+{
+    buffered_writer w;
+    if (!open_writer(w, filename))
+    {
+        write_line("Error: could not create " + filename);
+        return false;
+    }
+
+    // categorical columns go after the skills, by value so the file reads like the input
+    const vector<category_column> &categories = category_columns();
+    write_text(w, "team_id,member,leadership,frontend,backend,security,ui,english");
+    for (int c = 0; c < categories.size(); c++)
+    {
+        write_text(w, ",", 1);
+        write_csv_field(w, categories[c].name);
+    }
+    write_text(w, ",score,leader,team_total,team_size,team_has_leader\n");
+
+    long long rows = 0;
+    for (int t = 0; t < teams.size(); t++)
+    {
+        const team &tm = teams[t];
+        for (int m = 0; m < tm.members.size(); m++)
+        {
+            const student &s = tm.members[m];
+            write_int(w, tm.id);
+            write_text(w, ",", 1);
+            write_csv_field(w, s.name);
+
+            int skills[6] = {s.leadership, s.frontend, s.backend, s.security, s.ui, s.english};
+            for (int k = 0; k < 6; k++)
+            {
+                write_text(w, ",", 1);
+                write_int(w, skills[k]);
+            }
+
+            for (int c = 0; c < categories.size(); c++)
+            {
+                write_text(w, ",", 1);
+                if (s.category[c] < categories[c].values.size())
+                {
+                    write_csv_field(w, categories[c].values[s.category[c]]);
+                }
+            }
+
+            write_text(w, ",", 1);
+            write_score(w, s.student_score);
+            write_text(w, s.leadership >= LEADER_THRESHOLD ? ",1," : ",0,", 3);
+            write_score(w, tm.total_score);
+            write_text(w, ",", 1);
+            write_int(w, tm.members.size());
+            write_text(w, tm.hasLeader ? ",1\n" : ",0\n", 3);
+            rows++;
+        }
+    }
+
+    bool ok = close_writer(w);
+    if (ok)
+    {
+        write_line("Exported " + std::to_string(rows) + " rows to " + filename);
+    }
+    else
+    {
+        write_line("Error: writing " + filename + " failed.");
+    }
+    return ok;
+}
+
+/**
+ * export to json, streamed a team at a time
+ */
+bool export_teams_json(const string &filename, const vector<team> &teams)
+{
+    buffered_writer w;
+    if (!open_writer(w, filename))
+    {
+        write_line("Error: could not create " + filename);
+        return false;
+    }
+
+    const char *skill_keys[6] = {",\"leadership\":", ",\"frontend\":", ",\"backend\":", ",\"security\":", ",\"ui\":", ",\"english\":"};
+    const vector<category_column> &categories = category_columns();
+
+    write_text(w, "{\"teams\":[");
+    for (int t = 0; t < teams.size(); t++)
+    {
+        const team &tm = teams[t];
+        if (t > 0)
+        {
+            write_text(w, ",", 1);
+        }
+
+        write_text(w, "\n{\"id\":");
+        write_int(w, tm.id);
+        write_text(w, ",\"total\":");
+        write_score(w, tm.total_score);
+        write_text(w, ",\"size\":");
+        write_int(w, tm.members.size());
+        write_text(w, tm.hasLeader ? ",\"has_leader\":true" : ",\"has_leader\":false");
+        write_text(w, ",\"members\":[");
+
+        for (int m = 0; m < tm.members.size(); m++)
+        {
+            const student &s = tm.members[m];
+            if (m > 0)
+            {
+                write_text(w, ",", 1);
+            }
+
+            write_text(w, "{\"name\":");
+            write_json_string(w, s.name);
+
+            int skills[6] = {s.leadership, s.frontend, s.backend, s.security, s.ui, s.english};
+            for (int k = 0; k < 6; k++)
+            {
+                write_text(w, skill_keys[k], std::strlen(skill_keys[k]));
+                write_int(w, skills[k]);
+            }
+
+            // the same categorical columns the csv export has, keyed by column name
+            if (!categories.empty())
+            {
+                write_text(w, ",\"categories\":{");
+                for (int c = 0; c < categories.size(); c++)
+                {
+                    if (c > 0)
+                    {
+                        write_text(w, ",", 1);
+                    }
+                    write_json_string(w, categories[c].name);
+                    write_text(w, ":", 1);
+                    if (s.category[c] < categories[c].values.size())
+                    {
+                        write_json_string(w, categories[c].values[s.category[c]]);
+                    }
+                    else
+                    {
+                        write_text(w, "null", 4);
+                    }
+                }
+                write_text(w, "}", 1);
+            }
+
+            write_text(w, ",\"score\":");
+            write_score(w, s.student_score);
+            write_text(w, s.leadership >= LEADER_THRESHOLD ? ",\"leader\":true}" : ",\"leader\":false}");
+        }
+
+        write_text(w, "]}");
+    }
+    write_text(w, "\n]}\n");
+
+    bool ok = close_writer(w);
+    if (ok)
+    {
+        write_line("Exported " + std::to_string(teams.size()) + " teams to " + filename);
+    }
+    else
+    {
+        write_line("Error: writing " + filename + " failed.");
+    }
+    return ok;
+}
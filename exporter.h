@@ -0,0 +1,57 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+#include <cstdio>
+#include <cstddef>
+
+using std::vector;
+using std::string;
+
+// size of the reusable output buffer (one fwrite per this many bytes)
+const size_t EXPORT_BUFFER_BYTES = 1 << 20;
+
+// a file plus a big buffer that is reused for the whole export
+struct buffered_writer
+{
+    FILE *file;
+    vector<char> buffer;
+    size_t used;
+};
+
+// Open filename for writing (false if it can't be created).
+bool open_writer(buffered_writer &w, const string &filename);
+
+// Flush and close, returns false if any write failed along the way.
+bool close_writer(buffered_writer &w);
+
+// Append raw text.
+void write_text(buffered_writer &w, const char *text, size_t length);
+void write_text(buffered_writer &w, const char *text);
+void write_text(buffered_writer &w, const string &text);
+
+// Append an integer (formatted without any temporary string).
+void write_int(buffered_writer &w, long long value);
+
+// Append a fixed point score as a decimal, e.g. 127 -> 6.35.
+void write_score(buffered_writer &w, long long fixed_score);
+
+// Append a CSV field, quoted only if it contains a comma, quote or newline.
+void write_csv_field(buffered_writer &w, const string &text);
+
+// Append a JSON string literal with escaping.
+void write_json_string(buffered_writer &w, const string &text);
+
+/**
+ * Export every team member as one CSV row:
+ * team_id,member,leadership,frontend,backend,security,ui,english,<categorical columns>,score,leader,team_total,team_size,team_has_leader
+ * Teams are written one at a time, so memory use doesn't depend on the number of rows.
+ */
+bool export_teams_csv(const string &filename, const vector<team> &teams);
+
+/**
+ * Export the teams as JSON: {"teams":[{"id":1,"total":..,"size":..,"has_leader":..,"members":[..]}]}
+ * Members carry the same fields as the csv rows, categorical columns as a "categories":{"<column>":"<value>"} object.
+ */
+bool export_teams_json(const string &filename, const vector<team> &teams);
@@ -0,0 +1,156 @@
+// including relevant libraries (kept away from splashkit.h so the OS headers don't clash with it)
+#include "file_watcher.h"
+#include <chrono>
+#include <filesystem>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+// how often the polling fallback looks at the file
+const int64_t POLL_INTERVAL_MS = 1000;
+
+/**
+ * milliseconds on a monotonic clock
+ */
+static int64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * size and modification time of a file (both 0 if it can't be read right now)
+ */
+static void stat_file(const std::string &path, uint64_t &size, int64_t &mtime)
+{
+    std::error_code ec;
+    size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        size = 0;
+    }
+
+    std::filesystem::file_time_type t = std::filesystem::last_write_time(path, ec);
+    mtime = ec ? 0 : t.time_since_epoch().count();
+}
+
+/**
+ * start watching (the folder is watched on linux, editors often save by replacing the file)
+ */
+bool start_watching(file_watcher &w, const std::string &path)
+{
+    stop_watching(w);
+
+    std::filesystem::path p(path);
+    w.path = path;
+    w.name = p.filename().string();
+    w.pending = false;
+    w.last_poll_ms = now_ms();
+    stat_file(path, w.last_size, w.last_mtime);
+
+#ifdef __linux__
+    std::string folder = p.has_parent_path() ? p.parent_path().string() : std::string(".");
+
+    w.inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (w.inotify_fd >= 0)
+    {
+        w.watch_fd = inotify_add_watch(w.inotify_fd, folder.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+        if (w.watch_fd < 0)
+        {
+            close(w.inotify_fd);
+            w.inotify_fd = -1;
+        }
+    }
+#endif
+
+    w.active = true;
+    return true;
+}
+
+/**
+ * drain pending events, true if one of them was our file
+ */
+bool file_changed(file_watcher &w)
+{
+    if (!w.active)
+    {
+        return false;
+    }
+
+#ifdef __linux__
+    if (w.inotify_fd >= 0)
+    {
+        bool changed = false;
+        alignas(inotify_event) char buffer[4096];
+
+        while (true)
+        {
+            ssize_t got = read(w.inotify_fd, buffer, sizeof(buffer));
+            if (got <= 0)
+            {
+                break;
+            }
+
+            for (ssize_t off = 0; off < got;)
+            {
+                const inotify_event *e = (const inotify_event *)(buffer + off);
+                if (e->len > 0 && w.name == e->name)
+                {
+                    changed = true;
+                }
+                off += sizeof(inotify_event) + e->len;
+            }
+        }
+
+        return changed;
+    }
+#endif
+
+    // polling fallback, only report once size and time have stopped moving for one interval
+    int64_t now = now_ms();
+    if (now - w.last_poll_ms < POLL_INTERVAL_MS)
+    {
+        return false;
+    }
+    w.last_poll_ms = now;
+
+    uint64_t size;
+    int64_t mtime;
+    stat_file(w.path, size, mtime);
+
+    if (size != w.last_size || mtime != w.last_mtime)
+    {
+        w.last_size = size;
+        w.last_mtime = mtime;
+        w.pending = true;
+        return false;
+    }
+
+    if (w.pending)
+    {
+        w.pending = false;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * release everything
+ */
+void stop_watching(file_watcher &w)
+{
+#ifdef __linux__
+    if (w.active && w.inotify_fd >= 0)
+    {
+        close(w.inotify_fd);
+    }
+#endif
+
+    w.active = false;
+    w.inotify_fd = -1;
+    w.watch_fd = -1;
+    w.pending = false;
+}
@@ -0,0 +1,34 @@
+// including relevant libraries
+#pragma once
+#include <string>
+#include <cstdint>
+
+// watches one file for changes without blocking (inotify on linux, polling elsewhere)
+struct file_watcher
+{
+    std::string path;
+    std::string name;   // file name without the folder, to filter directory events
+    bool active;
+    int inotify_fd;
+    int watch_fd;
+    // used by the polling fallback
+    uint64_t last_size;
+    int64_t last_mtime;
+    bool pending;       // changed on the last poll, waiting for it to settle
+    int64_t last_poll_ms;
+};
+
+/**
+ * Start watching a file. Any previous watch on this watcher is stopped first.
+ */
+bool start_watching(file_watcher &w, const std::string &path);
+
+/**
+ * Non-blocking check, true once after the file has been rewritten (and finished being written).
+ */
+bool file_changed(file_watcher &w);
+
+/**
+ * Stop watching and release the OS handles.
+ */
+void stop_watching(file_watcher &w);
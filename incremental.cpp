@@ -0,0 +1,854 @@
+// including relevant libraries
+#include "incremental.h"
+#include "allocator.h"
+#include "optimizer.h"
+#include "roles.h"
+#include "splashkit.h"
+#include <algorithm>
+
+using std::vector;
+using std::to_string;
+
+/**
+ * true if team a should come out of the heap before team b
+ */
+static bool team_before(const team_heap &h, const vector<team> &teams, int a, int b)
+{
+    if (h.order == HEAP_HIGHEST_TOTAL)
+    {
+        if (teams[a].total_score != teams[b].total_score)
+        {
+            return teams[a].total_score > teams[b].total_score;
+        }
+        if (teams[a].size != teams[b].size)
+        {
+            return teams[a].size > teams[b].size;
+        }
+        return a < b;
+    }
+
+    if (h.order == HEAP_MOST_SERVED)
+    {
+        if (teams[a].size != teams[b].size)
+        {
+            return teams[a].size > teams[b].size;
+        }
+        if (teams[a].total_score != teams[b].total_score)
+        {
+            return teams[a].total_score > teams[b].total_score;
+        }
+        return a < b;
+    }
+
+    if (teams[a].total_score != teams[b].total_score)
+    {
+        return teams[a].total_score < teams[b].total_score;
+    }
+    if (teams[a].size != teams[b].size)
+    {
+        return teams[a].size < teams[b].size;
+    }
+    return a < b;
+}
+
+/**
+ * put heap slot i in place and remember where its team went
+ */
+static void heap_set(team_heap &h, int i, int t)
+{
+    h.heap[i] = t;
+    h.pos[t] = i;
+}
+
+/**
+ * move the team at slot i up while it beats its parent
+ */
+static void sift_up(team_heap &h, const vector<team> &teams, int i)
+{
+    int t = h.heap[i];
+    while (i > 0)
+    {
+        int parent = (i - 1) / 2;
+        if (!team_before(h, teams, t, h.heap[parent]))
+        {
+            break;
+        }
+        heap_set(h, i, h.heap[parent]);
+        i = parent;
+    }
+    heap_set(h, i, t);
+}
+
+/**
+ * move the team at slot i down while a child beats it
+ */
+static void sift_down(team_heap &h, const vector<team> &teams, int i)
+{
+    int n = h.heap.size();
+    int t = h.heap[i];
+    while (true)
+    {
+        int child = 2 * i + 1;
+        if (child >= n)
+        {
+            break;
+        }
+        if (child + 1 < n && team_before(h, teams, h.heap[child + 1], h.heap[child]))
+        {
+            child++;
+        }
+        if (!team_before(h, teams, h.heap[child], t))
+        {
+            break;
+        }
+        heap_set(h, i, h.heap[child]);
+        i = child;
+    }
+    heap_set(h, i, t);
+}
+
+void heap_reset(team_heap &h, int team_count, heap_order order)
+{
+    h.order = order;
+    h.heap.clear();
+    h.pos.assign(team_count, -1);
+}
+
+void heap_push(team_heap &h, const vector<team> &teams, int t)
+{
+    if (h.pos[t] != -1)
+    {
+        heap_update(h, teams, t);
+        return;
+    }
+
+    h.heap.push_back(t);
+    h.pos[t] = h.heap.size() - 1;
+    sift_up(h, teams, h.heap.size() - 1);
+}
+
+void heap_remove(team_heap &h, const vector<team> &teams, int t)
+{
+    int i = h.pos[t];
+    if (i == -1)
+    {
+        return;
+    }
+
+    int last = h.heap.back();
+    h.heap.pop_back();
+    h.pos[t] = -1;
+
+    // the removed team was the last slot, nothing to re-sort
+    if (last == t)
+    {
+        return;
+    }
+
+    heap_set(h, i, last);
+    sift_up(h, teams, i);
+    sift_down(h, teams, h.pos[last]);
+}
+
+void heap_update(team_heap &h, const vector<team> &teams, int t)
+{
+    int i = h.pos[t];
+    if (i == -1)
+    {
+        return;
+    }
+
+    sift_up(h, teams, i);
+    sift_down(h, teams, h.pos[t]);
+}
+
+int heap_top(const team_heap &h)
+{
+    if (h.heap.empty())
+    {
+        return -1;
+    }
+    return h.heap[0];
+}
+
+/**
+ * a heap keeps every ancestor ahead of its descendants, so with two teams left out the best of the
+ * rest has at most two ancestors and sits in the first seven slots
+ */
+int heap_best_excluding(const team_heap &h, const vector<team> &teams, int a, int b)
+{
+    int best = -1;
+    for (int i = 0; i < h.heap.size() && i < 7; i++)
+    {
+        int t = h.heap[i];
+        if (t != a && t != b && (best == -1 || team_before(h, teams, t, best)))
+        {
+            best = t;
+        }
+    }
+    return best;
+}
+
+/**
+ * the roster's heaps and sum in the form the swap delta reads them
+ */
+static total_extremes roster_extremes(const roster_state &st)
+{
+    total_extremes ext;
+    ext.highest = &st.highest;
+    ext.lowest = &st.lowest;
+    ext.sum = st.total_sum;
+    return ext;
+}
+
+/**
+ * put a team in (or take it out of) the open, missing and donor heaps depending on its current stats
+ */
+static void place_in_heaps(roster_state &st, const vector<team> &teams, int t)
+{
+    heap_push(st.lowest, teams, t);
+    heap_push(st.highest, teams, t);
+    heap_push(st.served, teams, t);
+
+    bool open = teams[t].size < st.size_cap;
+
+    if (open)
+    {
+        heap_push(st.open, teams, t);
+    }
+    else
+    {
+        heap_remove(st.open, teams, t);
+    }
+
+    for (int r = 0; r < st.roles; r++)
+    {
+        if (teams[t].role_counts[r] >= 2)
+        {
+            heap_push(st.donors[r], teams, t);
+        }
+        else
+        {
+            heap_remove(st.donors[r], teams, t);
+        }
+
+        if (open && teams[t].role_counts[r] == 0)
+        {
+            heap_push(st.missing[r], teams, t);
+        }
+        else
+        {
+            heap_remove(st.missing[r], teams, t);
+        }
+    }
+}
+
+void refresh_roster_team(roster_state &st, const vector<team> &teams, int t)
+{
+    place_in_heaps(st, teams, t);
+    st.changed.push_back(t);
+}
+
+/**
+ * rebuild both heaps from scratch (only when the cap moves, so at most once per k insertions)
+ */
+static void rebuild_heaps(roster_state &st, const vector<team> &teams)
+{
+    heap_reset(st.open, teams.size());
+    heap_reset(st.lowest, teams.size());
+    heap_reset(st.highest, teams.size(), HEAP_HIGHEST_TOTAL);
+    heap_reset(st.served, teams.size(), HEAP_MOST_SERVED);
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        heap_reset(st.missing[r], teams.size());
+        heap_reset(st.donors[r], teams.size(), HEAP_MOST_SERVED);
+    }
+
+    // the teams themselves didn't change, so nothing goes in st.changed
+    for (int t = 0; t < teams.size(); t++)
+    {
+        place_in_heaps(st, teams, t);
+    }
+}
+
+/**
+ * the cap that keeps every team within one member of the others once students are placed
+ */
+static int automatic_cap(long long students, int team_count)
+{
+    return (students + team_count - 1) / team_count;
+}
+
+void begin_roster(roster_state &st, const vector<team> &teams, int size_cap, const constraint_store *cs, balance_mode mode)
+{
+    st.cs = has_constraints(cs) ? cs : nullptr;
+    st.mode = mode;
+    st.roles = role_rules().size();
+    st.students = 0;
+    st.total_sum = 0;
+    st.changed.clear();
+    for (int t = 0; t < teams.size(); t++)
+    {
+        st.students += teams[t].members.size();
+        st.total_sum += teams[t].total_score;
+    }
+
+    st.auto_cap = (size_cap <= 0);
+    st.size_cap = size_cap;
+    if (st.auto_cap && !teams.empty())
+    {
+        st.size_cap = automatic_cap(st.students + 1, teams.size());
+    }
+
+    rebuild_heaps(st, teams);
+}
+
+int insert_student(vector<team> &teams, roster_state &st, const student &s, int repair_budget)
+{
+    if (teams.empty())
+    {
+        return -1;
+    }
+
+    // the automatic cap grows by one every k students, which re-opens every team
+    if (st.auto_cap)
+    {
+        int cap = automatic_cap(st.students + 1, teams.size());
+        if (cap != st.size_cap)
+        {
+            st.size_cap = cap;
+            rebuild_heaps(st, teams);
+        }
+    }
+
+    // a fixed cap that everyone has reached can't be kept, so it is raised rather than refusing the student
+    while (heap_top(st.open) == -1)
+    {
+        st.size_cap++;
+        write_line("All teams are full, raising the size cap to " + to_string(st.size_cap) + ".");
+        rebuild_heaps(st, teams);
+    }
+
+    // a student covering a role goes to the lowest team still missing one of their roles
+    int target = -1;
+    for (int r = 0; r < st.roles; r++)
+    {
+        int t = heap_top(st.missing[r]);
+        if (((s.roles >> r) & 1u) && t != -1 && (target == -1 || teams[t].total_score < teams[target].total_score))
+        {
+            target = t;
+        }
+    }
+    if (target == -1)
+    {
+        target = heap_top(st.open);
+    }
+
+    // a pinned student goes to their team whatever the cap says
+    int pin = pinned_team_of(st.cs, s);
+    if (pin != -1 && pin < teams.size())
+    {
+        target = pin;
+    }
+    else if (st.cs != nullptr && !fits_team(st.cs, teams, target, s, -1))
+    {
+        // rare, so a plain scan of the open teams for the lowest legal total is fine
+        int legal = -1;
+        for (int i = 0; i < st.open.heap.size(); i++)
+        {
+            int t = st.open.heap[i];
+            if (fits_team(st.cs, teams, t, s, -1) && (legal == -1 || teams[t].total_score < teams[legal].total_score))
+            {
+                legal = t;
+            }
+        }
+        if (legal != -1)
+        {
+            target = legal;
+        }
+        else
+        {
+            // nowhere legal is open, place them anyway and say so like allocate_teams does
+            write_line("Could not honour the constraints of " + s.name + ", placed in team " + to_string(target + 1) + ".");
+        }
+    }
+
+    add_member_to_team(teams[target], s);
+    st.students++;
+    st.total_sum += s.student_score;
+    refresh_roster_team(st, teams, target);
+
+    // local repair against the team that is now lowest overall, it is the one most likely to be out of balance
+    int partner = heap_top(st.lowest);
+    if (repair_budget > 0 && partner != -1 && partner != target)
+    {
+        total_extremes ext = roster_extremes(st);
+        if (improve_team_pair(teams, target, partner, repair_budget, st.cs, st.mode, &ext))
+        {
+            refresh_roster_team(st, teams, target);
+            refresh_roster_team(st, teams, partner);
+        }
+    }
+
+    return target;
+}
+
+void insert_students(vector<team> &teams, const vector<student> &batch, int size_cap, int repair_budget, const constraint_store *cs, balance_mode mode)
+{
+    if (teams.empty())
+    {
+        write_line("No teams to insert into, allocate teams first.");
+        return;
+    }
+
+    roster_state st;
+    begin_roster(st, teams, size_cap, cs, mode);
+
+    for (int i = 0; i < batch.size(); i++)
+    {
+        insert_student(teams, st, batch[i], repair_budget);
+    }
+
+    write_line("Inserted " + to_string(batch.size()) + " students into existing teams.");
+}
+
+/**
+ * move the member of donor that brings the two totals closest together into receiver,
+ * never taking the donor's only holder of a role, a pinned student or someone who must be kept apart from a receiver member.
+ * looks at no more than budget members
+ */
+static bool move_closest_member(vector<team> &teams, int donor_index, int receiver_index, int budget, const constraint_store *cs)
+{
+    team &donor = teams[donor_index];
+    team &receiver = teams[receiver_index];
+    long long gap = donor.total_score - receiver.total_score;
+    unsigned sole = team_sole_roles(donor);
+    int best = -1;
+    long long best_diff = 0;
+
+    for (int m = 0; m < donor.members.size() && m < budget; m++)
+    {
+        const student &s = donor.members[m];
+        if (s.roles & sole)
+        {
+            continue;
+        }
+        if (cs != nullptr && !fits_team(cs, teams, receiver_index, s, -1))
+        {
+            continue;
+        }
+
+        long long diff = gap - 2LL * s.student_score;
+        if (diff < 0)
+        {
+            diff = -diff;
+        }
+
+        if (best == -1 || diff < best_diff)
+        {
+            best = m;
+            best_diff = diff;
+        }
+    }
+
+    if (best == -1)
+    {
+        return false;
+    }
+
+    add_member_to_team(receiver, remove_member_at(donor, best));
+    return true;
+}
+
+void repair_after_removal(vector<team> &teams, roster_state &st, int team_index, unsigned lost_roles, int repair_budget)
+{
+    refresh_roster_team(st, teams, team_index);
+
+    // only roles the team just lost need replacing, and only a team with the role twice can give one up
+    for (int r = 0; r < st.roles; r++)
+    {
+        if (!((lost_roles >> r) & 1u) || teams[team_index].role_counts[r] > 0)
+        {
+            continue;
+        }
+
+        int donor = heap_top(st.donors[r]);
+        if (donor == -1 || donor == team_index)
+        {
+            write_line("No team has a spare " + role_rules()[r].name + " for Team " + to_string(team_index + 1) + ".");
+            continue;
+        }
+
+        // every swap that brings the role back wins on the penalty, so the pair search picks the best-balanced one.
+        // the whole pair is searched here, a team size squared at most
+        int pair_budget = teams[team_index].members.size() * teams[donor].members.size();
+        total_extremes ext = roster_extremes(st);
+        improve_team_pair(teams, team_index, donor, pair_budget, st.cs, st.mode, &ext);
+        refresh_roster_team(st, teams, donor);
+        refresh_roster_team(st, teams, team_index);
+    }
+
+    // sizes drifted two apart: take a replacement from the most over-served team, then tidy that pair
+    int served = heap_top(st.served);
+    if (served != -1 && served != team_index && teams[served].size - teams[team_index].size >= 2)
+    {
+        if (move_closest_member(teams, served, team_index, repair_budget, st.cs))
+        {
+            if (repair_budget > 0)
+            {
+                total_extremes ext = roster_extremes(st);
+                improve_team_pair(teams, team_index, served, repair_budget, st.cs, st.mode, &ext);
+            }
+            refresh_roster_team(st, teams, served);
+            refresh_roster_team(st, teams, team_index);
+        }
+    }
+}
+
+student remove_student(vector<team> &teams, roster_state &st, int team_index, int member_index, int repair_budget)
+{
+    student gone = remove_member_at(teams[team_index], member_index);
+    st.students--;
+    st.total_sum -= gone.student_score;
+
+    unsigned lost_roles = gone.roles & ~team_coverage(teams[team_index]);
+    repair_after_removal(teams, st, team_index, lost_roles, repair_budget);
+
+    return gone;
+}
+
+/**
+ * short finish after a change of k: swap between the highest and lowest team until that pair stops improving
+ */
+static void settle_extremes(vector<team> &teams, roster_state &st, int rounds)
+{
+    for (int r = 0; r < rounds; r++)
+    {
+        int lo = heap_top(st.lowest);
+        int hi = heap_top(st.highest);
+        if (lo == -1 || lo == hi)
+        {
+            return;
+        }
+
+        // the extreme pair is searched in full, one team size squared
+        int pair_budget = teams[hi].members.size() * teams[lo].members.size();
+        total_extremes ext = roster_extremes(st);
+        if (!improve_team_pair(teams, hi, lo, pair_budget, st.cs, st.mode, &ext))
+        {
+            return;
+        }
+
+        refresh_roster_team(st, teams, hi);
+        refresh_roster_team(st, teams, lo);
+    }
+}
+
+/**
+ * every heap of a roster, so a change in the number of teams can be applied to all of them
+ */
+static int roster_heaps(roster_state &st, team_heap *out[])
+{
+    int count = 0;
+    out[count++] = &st.open;
+    out[count++] = &st.lowest;
+    out[count++] = &st.highest;
+    out[count++] = &st.served;
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        out[count++] = &st.missing[r];
+        out[count++] = &st.donors[r];
+    }
+    return count;
+}
+
+/**
+ * make room for the team just pushed onto the end of teams and file it in the heaps
+ */
+static void roster_grow(roster_state &st, const vector<team> &teams)
+{
+    team_heap *heaps[4 + 2 * MAX_ROLES];
+    int count = roster_heaps(st, heaps);
+    for (int h = 0; h < count; h++)
+    {
+        heaps[h]->pos.push_back(-1);
+    }
+    refresh_roster_team(st, teams, teams.size() - 1);
+}
+
+/**
+ * take team index out of the roster and move the last team into its place, so only that one team
+ * changes index (an erase would shift every later team and every heap entry with it)
+ */
+static void roster_swap_remove(roster_state &st, vector<team> &teams, int index)
+{
+    int last = teams.size() - 1;
+    team_heap *heaps[4 + 2 * MAX_ROLES];
+    int count = roster_heaps(st, heaps);
+
+    for (int h = 0; h < count; h++)
+    {
+        heap_remove(*heaps[h], teams, index);
+    }
+
+    st.students -= teams[index].size;
+    st.total_sum -= teams[index].total_score;
+
+    if (index != last)
+    {
+        teams[index] = std::move(teams[last]);
+        teams[index].id = index + 1;
+
+        // same stats under a new index, only ties on the index can move it
+        for (int h = 0; h < count; h++)
+        {
+            int i = heaps[h]->pos[last];
+            heaps[h]->pos[last] = -1;
+            if (i != -1)
+            {
+                heap_set(*heaps[h], i, index);
+                heap_update(*heaps[h], teams, index);
+            }
+        }
+    }
+
+    teams.pop_back();
+    for (int h = 0; h < count; h++)
+    {
+        heaps[h]->pos.pop_back();
+    }
+}
+
+/**
+ * mark every team some resolved pin sends a student to, O(pins + k)
+ */
+static void mark_pin_targets(const constraint_store *cs, int team_count, vector<bool> &out)
+{
+    out.assign(team_count, false);
+    if (!has_constraints(cs))
+    {
+        return;
+    }
+    for (int i = 0; i < cs->pin_ids.size(); i++)
+    {
+        int t = cs->pins[i].second;
+        if (cs->pin_ids[i] != -1 && t < team_count)
+        {
+            out[t] = true;
+        }
+    }
+}
+
+/**
+ * pins are team positions: the team that moved from from to to takes its pins along
+ */
+static void move_pins(constraint_store *cs, int from, int to)
+{
+    if (cs == nullptr)
+    {
+        return;
+    }
+    for (int i = 0; i < cs->pins.size(); i++)
+    {
+        if (cs->pins[i].second != from)
+        {
+            continue;
+        }
+        cs->pins[i].second = to;
+        if (cs->pin_ids[i] != -1)
+        {
+            cs->pinned_team[cs->pin_ids[i]] = to;
+        }
+    }
+}
+
+/**
+ * add_team on a roster the caller keeps (see incremental.h)
+ */
+static int add_team_to_roster(vector<team> &teams, roster_state &st, int repair_budget)
+{
+    team fresh{};
+    fresh.members.clear();
+    fresh.size = 0;
+    fresh.total_score = 0;
+    fresh.hasLeader = false;
+    fresh.leaders = 0;
+    fresh.id = teams.size() + 1;
+    teams.push_back(fresh);
+
+    int index = teams.size() - 1;
+    roster_grow(st, teams);
+
+    // the new team ends up as big as the smallest of the others, aiming for the average total
+    int target = st.students / teams.size();
+    long long mean_total = st.total_sum / teams.size();
+
+    while (teams[index].size < target)
+    {
+        int donor = heap_top(st.served);
+        if (donor == -1 || donor == index || teams[donor].size <= teams[index].size + 1)
+        {
+            break;
+        }
+
+        team &from = teams[donor];
+        team &to = teams[index];
+
+        // spread what the new team still needs over the seats it still has
+        long long wanted = (mean_total - to.total_score) / (target - to.size);
+        unsigned sole = team_sole_roles(from);
+        unsigned want_roles = required_roles() & ~team_coverage(to) & team_coverage(from) & ~sole;
+
+        int best = -1;
+        long long best_diff = 0;
+        for (int m = 0; m < from.members.size() && m < repair_budget; m++)
+        {
+            const student &s = from.members[m];
+            if ((s.roles & sole) || (want_roles && !(s.roles & want_roles)) || !fits_team(st.cs, teams, index, s, -1))
+            {
+                continue;
+            }
+
+            long long diff = s.student_score - wanted;
+            if (diff < 0)
+            {
+                diff = -diff;
+            }
+
+            if (best == -1 || diff < best_diff)
+            {
+                best = m;
+                best_diff = diff;
+            }
+        }
+
+        // nobody with a wanted role was in the looked-at members, take anyone the donor can spare instead
+        if (best == -1 && want_roles)
+        {
+            for (int m = 0; m < from.members.size(); m++)
+            {
+                if (!(from.members[m].roles & sole) && fits_team(st.cs, teams, index, from.members[m], -1))
+                {
+                    best = m;
+                    break;
+                }
+            }
+        }
+        if (best == -1)
+        {
+            break;
+        }
+
+        add_member_to_team(to, remove_member_at(from, best));
+        refresh_roster_team(st, teams, donor);
+        refresh_roster_team(st, teams, index);
+    }
+
+    // roles the draws didn't bring in come from teams that have them twice
+    repair_after_removal(teams, st, index, required_roles() & ~team_coverage(teams[index]), repair_budget);
+    settle_extremes(teams, st, teams.size());
+    return index;
+}
+
+/**
+ * remove_team on a roster the caller keeps (see incremental.h)
+ */
+static bool remove_team_from_roster(vector<team> &teams, roster_state &st, int team_index, int repair_budget, constraint_store *cs)
+{
+    if (teams.size() <= 1 || team_index < 0 || team_index >= teams.size())
+    {
+        write_line("Can't remove that team, at least one team has to stay.");
+        return false;
+    }
+
+    // its pinned students would have nowhere to go
+    vector<bool> pinned;
+    mark_pin_targets(cs, teams.size(), pinned);
+    if (pinned[team_index])
+    {
+        write_line("Team " + to_string(team_index + 1) + " has pinned students, unpin them before removing it.");
+        return false;
+    }
+
+    vector<student> orphans;
+    orphans.swap(teams[team_index].members);
+
+    int last = teams.size() - 1;
+    roster_swap_remove(st, teams, team_index);
+    if (team_index != last && has_constraints(cs))
+    {
+        move_pins(cs, last, team_index);
+    }
+
+    // biggest scores first, the same order the greedy allocation uses
+    std::sort(orphans.begin(), orphans.end(), [](const student &a, const student &b)
+              { return a.student_score > b.student_score; });
+
+    for (int i = 0; i < orphans.size(); i++)
+    {
+        insert_student(teams, st, orphans[i], repair_budget);
+    }
+
+    settle_extremes(teams, st, teams.size());
+    return true;
+}
+
+int add_team(vector<team> &teams, int repair_budget, const constraint_store *cs, balance_mode mode)
+{
+    roster_state st;
+    begin_roster(st, teams, 0, cs, mode);
+    return add_team_to_roster(teams, st, repair_budget);
+}
+
+bool remove_team(vector<team> &teams, int team_index, int repair_budget, constraint_store *cs, balance_mode mode)
+{
+    roster_state st;
+    begin_roster(st, teams, 0, cs, mode);
+    return remove_team_from_roster(teams, st, team_index, repair_budget, cs);
+}
+
+void set_team_count(vector<team> &teams, int team_count, int repair_budget, constraint_store *cs, balance_mode mode)
+{
+    if (team_count <= 0)
+    {
+        write_line("Number of teams must be > 0.");
+        return;
+    }
+
+    // one roster for every step, each add or remove only touches the teams it changes
+    roster_state st;
+    begin_roster(st, teams, 0, cs, mode);
+
+    while (teams.size() < team_count)
+    {
+        add_team_to_roster(teams, st, repair_budget);
+    }
+
+    vector<bool> pinned;
+    while (teams.size() > team_count)
+    {
+        // the smallest team nobody is pinned to
+        mark_pin_targets(cs, teams.size(), pinned);
+        int smallest = -1;
+        for (int t = 0; t < teams.size(); t++)
+        {
+            if (!pinned[t] && (smallest == -1 || teams[t].size < teams[smallest].size))
+            {
+                smallest = t;
+            }
+        }
+        if (smallest == -1)
+        {
+            write_line("Every team has pinned students, stopping at " + to_string(teams.size()) + " teams.");
+            return;
+        }
+        remove_team_from_roster(teams, st, smallest, repair_budget, cs);
+    }
+}
+
+void settle_teams(vector<team> &teams, int rounds, const constraint_store *cs, balance_mode mode)
+{
+    roster_state st;
+    begin_roster(st, teams, 0, cs, mode);
+    settle_extremes(teams, st, rounds);
+}
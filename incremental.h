@@ -0,0 +1,130 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include <vector>
+
+using std::vector;
+
+// how many swap candidates the local repair after an insertion or removal may look at
+const int DEFAULT_REPAIR_BUDGET = 256;
+
+// what a team_heap puts on top
+enum heap_order
+{
+    HEAP_LOWEST_TOTAL, // like choose_best_team_index: lowest total, then smaller size
+    HEAP_MOST_SERVED,  // biggest team first, then the highest total
+    HEAP_HIGHEST_TOTAL // highest total, then bigger size
+};
+
+// indexed binary heap of team indices (ties go to the lower index). pos[t] is -1 when t is not in the heap
+struct team_heap
+{
+    vector<int> heap;
+    vector<int> pos;
+    heap_order order;
+};
+
+// Empty the heap and size it for team_count teams.
+void heap_reset(team_heap &h, int team_count, heap_order order = HEAP_LOWEST_TOTAL);
+
+// Add, remove or re-sort team t after its total or size changed (all O(log k)).
+void heap_push(team_heap &h, const vector<team> &teams, int t);
+void heap_remove(team_heap &h, const vector<team> &teams, int t);
+void heap_update(team_heap &h, const vector<team> &teams, int t);
+
+// Best team in the heap, or -1 if it's empty.
+int heap_top(const team_heap &h);
+
+// Best team in the heap other than a and b, or -1 if there is none. O(1), it is always in the top three levels.
+// a and b may be out of date in the heap, every other team has to be current.
+int heap_best_excluding(const team_heap &h, const vector<team> &teams, int a, int b);
+
+// everything the incremental operations keep between calls, so none of them rescan all k teams
+struct roster_state
+{
+    team_heap open;       // teams below the size cap
+    team_heap missing[MAX_ROLES]; // per role, open teams nobody covers it in (students with that role go here first)
+    team_heap lowest;     // every team, the repair partner is the lowest total overall
+    team_heap highest;    // every team, the other end for the short optimisation after a change of k
+    team_heap served;     // every team, the biggest and richest first (where replacements come from)
+    team_heap donors[MAX_ROLES];  // per role, teams with it twice, the biggest and richest first
+    int roles;            // how many role rules there were when the roster began
+    const constraint_store *cs; // pins and apart rules every move has to respect (nullptr = none)
+    balance_mode mode;          // what the local repairs balance
+    int size_cap;
+    bool auto_cap;        // cap follows ceil(students / teams) as students arrive
+    long long students;
+    long long total_sum;  // sum of every team total, with highest and lowest it prices swaps in the extreme modes
+    vector<int> changed;  // teams refreshed since the caller last cleared it (for indexes kept next to the roster)
+};
+
+/**
+ * Build the heaps for a set of teams (O(k)). size_cap <= 0 keeps teams within one of each other.
+ */
+void begin_roster(roster_state &st, const vector<team> &teams, int size_cap, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Put one student into the best open team (one missing a role they cover first),
+ * or their pinned team, skipping teams with someone they must be kept apart from. Then run a local repair of at most repair_budget swap candidates. O(log k) + the repair.
+ * If no open team keeps their apart rules they still join the best one, and that is reported.
+ *
+ * @returns the index of the team the student joined, -1 if there are no teams
+ */
+int insert_student(vector<team> &teams, roster_state &st, const student &s, int repair_budget);
+
+/**
+ * Insert a batch of late enrolments into existing teams without reallocating.
+ */
+void insert_students(vector<team> &teams, const vector<student> &batch, int size_cap, int repair_budget, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Take a withdrawn member out of their team (O(1) stats) and repair around that team only.
+ *
+ * @returns the student that was removed
+ */
+student remove_student(vector<team> &teams, roster_state &st, int team_index, int member_index, int repair_budget);
+
+/**
+ * The repair half of remove_student, for callers that already took the member out themselves.
+ * Pulls a replacement from the most over-served team if sizes drifted two apart, and looks for a
+ * replacement only for the roles in lost_roles (roles the team no longer covers).
+ */
+void repair_after_removal(vector<team> &teams, roster_state &st, int team_index, unsigned lost_roles, int repair_budget);
+
+/**
+ * Re-check a team's place in the heaps after something outside these operations changed it.
+ * Every team an operation changes goes through here, so it is also noted in st.changed.
+ */
+void refresh_roster_team(roster_state &st, const vector<team> &teams, int t);
+
+
+/**
+ * Add one empty team and fill it from the biggest, richest teams (heap-guided), then settle.
+ * Everyone who isn't drawn keeps their team. Builds a roster (O(k)), set_team_count shares one across steps.
+ *
+ * @returns the index of the new team
+ */
+int add_team(vector<team> &teams, int repair_budget, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Remove the team at team_index and hand its members to the rest through insert_student, then settle.
+ * The last team moves into the gap and takes its number; pins to it are moved along in cs, so pinned
+ * students stay with their team. A team someone is pinned to is not removed.
+ *
+ * @returns false if it is the last team or someone is pinned to it
+ */
+bool remove_team(vector<team> &teams, int team_index, int repair_budget, constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Add or remove teams one at a time until there are team_count, keeping existing assignments where possible.
+ * The smallest team nobody is pinned to is the one removed. One roster is built for the whole change
+ * rather than one per team added or removed.
+ */
+void set_team_count(vector<team> &teams, int team_count, int repair_budget, constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Short optimisation: up to rounds full pair searches between the highest and lowest team.
+ */
+void settle_teams(vector<team> &teams, int rounds, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
@@ -1,14 +1,20 @@
 #include "io.h"
+#include "mapped_file.h"
+#include "snapshot.h"
+#include "categories.h"
+#include "availability.h"
+#include "scoring.h"
 #include "splashkit.h"
-#include <fstream>
-#include <sstream>
 #include <string>
 #include <cctype>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <thread>
+#include <charconv>
 
 
 using std::vector;
-using std::ifstream;
-using std::stringstream;
 using std::string;
 
 /**
@@ -42,167 +48,926 @@ std::string trim_string(const std::string &s)
 }
 
 /**
- * convert string to integer using catch if it fails to avoid crashing
+ * same characters as std::isspace in the "C" locale, without the locale lookup
  */
-int safe_stoi(const std::string &token, int fallback)
+static bool is_space_char(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\v' || c == '\f';
+}
+
+/**
+ * trim a character range in place (nothing is copied)
+ */
+static void trim_range(const char *&begin, const char *&end)
+{
+    while (begin < end && is_space_char(*begin))
+    {
+        begin++;
+    }
+
+    while (end > begin && is_space_char(*(end - 1)))
+    {
+        end--;
+    }
+}
+
+/**
+ * parse a whole cell as an integer straight from the buffer with std::from_chars (no copies, no exceptions)
+ */
+parse_status parse_int_field(const char *begin, const char *end, int &value)
 {
-    std::string t = trim_string(token); // trim first
+    trim_range(begin, end);
 
     // error handling
-    if (t.empty())
+    if (begin == end)
+    {
+        return PARSE_BLANK;
+    }
+
+    // from_chars doesn't take a leading +
+    if (*begin == '+' && end - begin > 1 && *(begin + 1) != '-')
+    {
+        begin++;
+    }
+
+    int parsed = 0;
+    std::from_chars_result r = std::from_chars(begin, end, parsed);
+
+    // the whole cell has to be the number
+    if (r.ec == std::errc::result_out_of_range)
+    {
+        return PARSE_OUT_OF_RANGE;
+    }
+    if (r.ec != std::errc() || r.ptr != end)
+    {
+        return PARSE_INVALID;
+    }
+
+    value = parsed;
+    return PARSE_OK;
+}
+
+/**
+ * parse a skill cell. skills are 1-10 (0 = missing), so one and two digit cells are handled
+ * without calling into from_chars, and anything outside 0-10 is clamped into range
+ */
+parse_status parse_skill_field(const char *begin, const char *end, int &value)
+{
+    trim_range(begin, end);
+    long length = end - begin;
+
+    // fast path for "7" and "10"
+    if (length == 1 && (unsigned)(begin[0] - '0') <= 9)
+    {
+        value = begin[0] - '0';
+        return PARSE_OK;
+    }
+
+    if (length == 2 && (unsigned)(begin[0] - '0') <= 9 && (unsigned)(begin[1] - '0') <= 9)
+    {
+        int parsed = (begin[0] - '0') * 10 + (begin[1] - '0');
+        if (parsed <= SKILL_MAX)
+        {
+            value = parsed;
+            return PARSE_OK;
+        }
+        value = SKILL_MAX;
+        return PARSE_OUT_OF_RANGE;
+    }
+
+    // everything else (signs, blanks, junk, big numbers) takes the general path
+    int parsed = 0;
+    parse_status status = parse_int_field(begin, end, parsed);
+
+    if (status == PARSE_OUT_OF_RANGE)
+    {
+        value = (*begin == '-') ? 0 : SKILL_MAX;
+        return status;
+    }
+
+    if (status != PARSE_OK)
+    {
+        return status;
+    }
+
+    if (parsed < 0 || parsed > SKILL_MAX)
+    {
+        value = (parsed < 0) ? 0 : SKILL_MAX;
+        return PARSE_OUT_OF_RANGE;
+    }
+
+    value = parsed;
+    return PARSE_OK;
+}
+
+/**
+ * convert string to integer, returns fallback if it isn't a whole number (nothing is thrown or copied)
+ */
+int safe_stoi(const std::string &token, int fallback)
+{
+    int value = 0;
+    if (parse_int_field(token.data(), token.data() + token.size(), value) != PARSE_OK)
     {
         return fallback;
     }
 
-    // using catch as taught in programmers.guide
-    try
+    return value;
+}
+
+/**
+ * strip one pair of surrounding quotes from a trimmed field
+ */
+static void unquote_range(const char *&begin, const char *&end)
+{
+    if (end - begin >= 2 && *begin == '"' && *(end - 1) == '"')
     {
-        size_t idx = 0;
-        long value = std::stol(t, &idx);
-        if (idx != t.size()) 
+        begin++;
+        end--;
+    }
+}
+
+/**
+ * copy a quoted field into a string, dropping the quotes and turning "" back into "
+ */
+static void assign_unquoted(std::string &out, const char *begin, const char *end)
+{
+    out.clear();
+    bool in_quotes = false;
+
+    for (const char *p = begin; p < end; p++)
+    {
+        if (*p != '"')
+        {
+            out.push_back(*p);
+        }
+        else if (in_quotes && p + 1 < end && *(p + 1) == '"')
         {
-            return fallback;
+            // escaped quote inside a quoted field
+            out.push_back('"');
+            p++;
         }
+        else
+        {
+            in_quotes = !in_quotes;
+        }
+    }
+}
+
+/**
+ * find the newline that ends the row starting at p. newlines inside quotes don't end a row,
+ * so they are counted into extra_lines instead. rows without quotes only cost one memchr
+ */
+static const char *find_row_end(const char *p, const char *end, bool &has_quotes, int &extra_lines)
+{
+    const char *nl = (const char *)std::memchr(p, '\n', end - p);
+    if (nl == nullptr)
+    {
+        nl = end;
+    }
 
-        return value;
+    has_quotes = (std::memchr(p, '"', nl - p) != nullptr);
+    if (!has_quotes)
+    {
+        return nl;
     }
 
-    catch (...)
+    // slow path, walk the row keeping track of quotes
+    bool in_quotes = false;
+    for (const char *c = p; c < end; c++)
     {
-        return fallback; 
+        if (*c == '"')
+        {
+            in_quotes = !in_quotes;
+        }
+        else if (*c == '\n')
+        {
+            if (!in_quotes)
+            {
+                return c;
+            }
+            extra_lines++;
+        }
     }
+
+    return end;
 }
 
 /**
- * load students from CSV file
+ * find the comma ending the field at p (or row_end), skipping commas inside quotes
  */
-std::vector<student> load_students_from_csv(const std::string &filename)
+static const char *find_field_end(const char *p, const char *row_end, bool has_quotes)
 {
-    std::vector<student> students;
-    std::ifstream file(filename.c_str());
+    if (!has_quotes)
+    {
+        const char *comma = (const char *)std::memchr(p, ',', row_end - p);
+        return (comma != nullptr) ? comma : row_end;
+    }
 
-    // error handling
-    if (!file.is_open())
+    bool in_quotes = false;
+    for (const char *c = p; c < row_end; c++)
     {
-        write_line("Error: Could not open file: " + filename);
-        return students;
+        if (*c == '"')
+        {
+            in_quotes = !in_quotes;
+        }
+        else if (*c == ',' && !in_quotes)
+        {
+            return c;
+        }
     }
 
-    // each line from file is held in 'line'
-    std::string line;
-    // which line we're on
-    int line_no = 1;
+    return row_end;
+}
+
+// a problem found while parsing, printed once all chunks are back so the output stays in file order
+struct csv_diagnostic
+{
+    int line;            // line inside the chunk (0 = first line of the chunk)
+    std::string message; // text after "line N: "
+};
+
+// everything one chunk of the file produced
+struct csv_chunk_result
+{
+    vector<student> students;
+    vector<csv_diagnostic> diagnostics;
+    int line_count; // physical lines in the chunk, used to number the next chunk
+    vector<category_column> categories; // this chunk's own category codes, merged once every chunk is back
+    int slots = 0;                       // widest availability cell in the chunk
+};
+
+/**
+ * parse every row in [begin, end) straight out of the buffer and append a student per row,
+ * using the plan to know which column feeds which field
+ */
+static void parse_student_rows(const char *begin, const char *end, const csv_parse_plan &plan, csv_chunk_result &result)
+{
+    const char *line = begin;
+    // which line of the chunk we're on
+    int line_no = 0;
+
+    // one row per line at most, so reserving this means the vector never has to move names around
+    result.students.reserve(std::count(begin, end, '\n') + 1);
 
-    // Skip the first line which is the headers
-    std::getline(file, line);
+    // chunks run side by side, so each interns category values into its own dictionary
+    result.categories.assign(plan.category_names.size(), category_column());
+    std::string category_value;
 
-    // read file line by line
-    while (std::getline(file, line))
+    while (line < end)
     {
-        // trim the whitespace around the line
-        std::string raw = trim_string(line);
+        // find the end of this row
+        bool has_quotes = false;
+        int extra_lines = 0;
+        const char *line_end = find_row_end(line, end, has_quotes, extra_lines);
+        const char *next_line = line_end + (line_end < end ? 1 : 0);
+        int row_line = line_no;
+        line_no += 1 + extra_lines;
+
+        // trim the whitespace around the line (this also drops the \r of windows line endings)
+        const char *raw_begin = line;
+        const char *raw_end = line_end;
+        trim_range(raw_begin, raw_end);
 
         // skip the line if its blank
-        if (raw.empty())
+        if (raw_begin == raw_end)
         {
-            line_no++;
+            line = next_line;
             continue;
         }
 
-        // create string stream to separate values between commas
-        std::stringstream ss(line);
-        student s;
-        std::string token;
-
-        // separate names
-        // skip the line if its missing data (error handling)
-        if (!std::getline(ss, token, ','))
+        // a quote that never closed swallows the rest of the file, so say where it started
+        if (has_quotes && line_end == end && std::count(line, end, '"') % 2 != 0)
         {
-            write_line("Skipping skewed CSV line " + std::to_string(line_no));
-            line_no++;
-            continue;
+            result.diagnostics.push_back({row_line, "unterminated quoted field"});
         }
-        // store the student's name (trimmed)
-        s.name = trim_string(token);
 
-        // store student's leadership score
+        // construct the student directly inside the cohort vector
+        result.students.emplace_back();
+        student &s = result.students.back();
 
-        if (!std::getline(ss, token, ',')) 
+        // skill fields in csv_field order, anything missing defaults to 0 like before
+        int *skills[6] = {&s.leadership, &s.frontend, &s.backend, &s.security, &s.ui, &s.english};
+        for (int f = 0; f < 6; f++)
         {
-            // error handling, if leadership score is missing then default to 0
-            s.leadership = 0; 
+            *skills[f] = 0;
         }
-        else 
+
+        // walk the columns the plan needs, columns after the last needed one are never looked at
+        const char *field = line;
+        for (int col = 0; col <= plan.last_needed; col++)
         {
-            // convert safely to integer
-            s.leadership = stoi(token, 0);
+            const char *field_end = find_field_end(field, line_end, has_quotes);
+            int kind = plan.columns[col];
+
+            if (kind == FIELD_NAME)
+            {
+                // store the student's name (trimmed)
+                const char *name_begin = field;
+                const char *name_end = field_end;
+                trim_range(name_begin, name_end);
+                if (has_quotes)
+                {
+                    assign_unquoted(s.name, name_begin, name_end);
+                }
+                else
+                {
+                    s.name.assign(name_begin, name_end);
+                }
+            }
+            else if (kind == FIELD_AVAILABILITY)
+            {
+                const char *value_begin = field;
+                const char *value_end = field_end;
+                if (has_quotes)
+                {
+                    trim_range(value_begin, value_end);
+                    unquote_range(value_begin, value_end);
+                }
+                int slots = parse_availability_cell(value_begin, value_end, s.availability);
+                result.slots = std::max(result.slots, slots);
+            }
+            else if (kind >= FIELD_CATEGORY)
+            {
+                // categorical cells are trimmed and unquoted like names, then turned into a code
+                const char *value_begin = field;
+                const char *value_end = field_end;
+                trim_range(value_begin, value_end);
+                if (has_quotes)
+                {
+                    assign_unquoted(category_value, value_begin, value_end);
+                    value_begin = category_value.data();
+                    value_end = value_begin + category_value.size();
+                }
+                int c = kind - FIELD_CATEGORY;
+                s.category[c] = intern_category_value(result.categories[c], value_begin, value_end, 256);
+            }
+            else if (kind != FIELD_SKIP)
+            {
+                // convert safely to integer
+                const char *value_begin = field;
+                const char *value_end = field_end;
+                if (has_quotes)
+                {
+                    trim_range(value_begin, value_end);
+                    unquote_range(value_begin, value_end);
+                }
+                // blank cells quietly stay 0, anything else odd gets reported
+                int *target = skills[kind - FIELD_LEADERSHIP];
+                parse_status status = parse_skill_field(value_begin, value_end, *target);
+
+                if (status == PARSE_INVALID)
+                {
+                    *target = 0;
+                    result.diagnostics.push_back({row_line, "column " + std::to_string(col + 1) + " is not a number (\"" + std::string(value_begin, value_end) + "\"), using 0"});
+                }
+                else if (status == PARSE_OUT_OF_RANGE)
+                {
+                    result.diagnostics.push_back({row_line, "column " + std::to_string(col + 1) + " is outside 0-" + std::to_string(SKILL_MAX) + ", using " + std::to_string(*target)});
+                }
+            }
+
+            // error handling, the row ran out of fields so the rest stay at their defaults
+            if (field_end == line_end)
+            {
+                break;
+            }
+            field = field_end + 1;
         }
 
-        // frontend score
-        if (!std::getline(ss, token, ',')) 
+        // intializing values
+        s.student_score = 0;
+        s.x = 0.0;
+        s.y = 0.0;
+        s.selected = false;
+
+        line = next_line;
+    }
+
+    result.line_count = line_no;
+}
+
+/**
+ * squash a header name down to lowercase letters and digits, dropping bracketed parts
+ * so "UI/UX (1-10)" becomes "uiux"
+ */
+static std::string normalise_header(const char *begin, const char *end)
+{
+    std::string key;
+    int depth = 0;
+
+    for (const char *p = begin; p < end; p++)
+    {
+        char c = *p;
+        if (c == '(' || c == '[')
         {
-            // error handling
-            s.frontend = 0;
+            depth++;
         }
-        else 
+        else if ((c == ')' || c == ']') && depth > 0)
         {
-            // convert integer safely
-            s.frontend = stoi(token, 0);
+            depth--;
         }
+        else if (depth == 0 && std::isalnum((unsigned char)c))
+        {
+            key.push_back(std::tolower((unsigned char)c));
+        }
+    }
+
+    return key;
+}
+
+/**
+ * which student field a normalised header name feeds (FIELD_SKIP if we don't know it)
+ */
+static int field_for_header(const std::string &key)
+{
+    if (key == "name" || key == "studentname" || key == "fullname" || key == "student")
+    {
+        return FIELD_NAME;
+    }
+    if (key == "leadership" || key == "leader")
+    {
+        return FIELD_LEADERSHIP;
+    }
+    if (key == "frontend")
+    {
+        return FIELD_FRONTEND;
+    }
+    if (key == "backend")
+    {
+        return FIELD_BACKEND;
+    }
+    if (key == "security")
+    {
+        return FIELD_SECURITY;
+    }
+    if (key == "uiux" || key == "ui" || key == "ux")
+    {
+        return FIELD_UI;
+    }
+    if (key == "english")
+    {
+        return FIELD_ENGLISH;
+    }
+    if (key == "availability" || key == "available" || key == "slots" || key == "freeslots")
+    {
+        return FIELD_AVAILABILITY;
+    }
+    return FIELD_SKIP;
+}
+
+/**
+ * the fixed layout the loader always assumed: Name, Leadership, Frontend, Backend, Security, UI/UX, English
+ */
+csv_parse_plan default_csv_parse_plan()
+{
+    csv_parse_plan plan;
+    for (int f = FIELD_NAME; f <= FIELD_ENGLISH; f++)
+    {
+        plan.columns.push_back(f);
+    }
+    plan.last_needed = plan.columns.size() - 1;
+    return plan;
+}
+
+/**
+ * read the header line once and work out which column feeds which field
+ */
+csv_parse_plan build_csv_parse_plan(const char *begin, const char *end)
+{
+    // error handling, an empty file has no header at all
+    if (begin == end)
+    {
+        return default_csv_parse_plan();
+    }
+
+    csv_parse_plan plan;
+    plan.last_needed = -1;
 
-        // backend scroe
-        if (!std::getline(ss, token, ',')) 
+    bool has_quotes = (std::memchr(begin, '"', end - begin) != nullptr);
+    bool seen[FIELD_CATEGORY] = {false};
+    int found = 0;
+
+    const char *field = begin;
+    while (true)
+    {
+        const char *field_end = find_field_end(field, end, has_quotes);
+        int kind = field_for_header(normalise_header(field, field_end));
+
+        // "Programme (category)" columns are kept as codes, up to MAX_CATEGORIES of them
+        std::string category_name;
+        if (is_category_header(field, field_end, category_name) && plan.category_names.size() < MAX_CATEGORIES)
         {
-            s.backend = 0;
+            kind = FIELD_CATEGORY + plan.category_names.size();
+            plan.category_names.push_back(category_name);
         }
-        else 
+
+        // only the first column for a field counts, repeats are skipped
+        else if (kind != FIELD_SKIP && seen[kind])
         {
-            s.backend = stoi(token, 0);
+            kind = FIELD_SKIP;
         }
 
-        // security score
-        if (!std::getline(ss, token, ',')) 
+        if (kind != FIELD_SKIP)
         {
-            s.security   = 0;
+            if (kind < FIELD_CATEGORY)
+            {
+                seen[kind] = true;
+                found++;
+            }
+            plan.last_needed = plan.columns.size();
         }
         else
         {
-            s.security   = stoi(token, 0);
-        } 
+            const char *b = field;
+            const char *e = field_end;
+            trim_range(b, e);
+            write_line("Ignoring CSV column " + std::to_string(plan.columns.size() + 1) + " (" + std::string(b, e) + ")");
+        }
+
+        plan.columns.push_back(kind);
 
-        // ui/ux score
-        if (!std::getline(ss, token, ','))
+        if (field_end == end)
         {
-            s.ui = 0;
-        }  
-        else 
+            break;
+        }
+        field = field_end + 1;
+    }
+
+    // nothing recognisable, so fall back to the fixed layout
+    if (found == 0)
+    {
+        write_line("CSV header not recognised, assuming Name, Leadership, Frontend, Backend, Security, UI/UX, English.");
+        return default_csv_parse_plan();
+    }
+
+    return plan;
+}
+
+/**
+ * split [begin, end) into about num_chunks pieces that each start at the beginning of a row.
+ * every quote toggles "inside a field", so the quote parity before a cut tells us whether a
+ * newline there really ends a row. parities are counted in parallel, then each cut moves
+ * forward to the first newline that is outside quotes
+ */
+static vector<const char *> split_csv_chunks(const char *begin, const char *end, int num_chunks)
+{
+    size_t length = end - begin;
+
+    // nominal cut points
+    vector<const char *> cuts(num_chunks + 1);
+    for (int i = 0; i <= num_chunks; i++)
+    {
+        cuts[i] = begin + (length * i) / num_chunks;
+    }
+
+    // quote parity of each nominal piece
+    vector<int> odd_quotes(num_chunks, 0);
+    vector<std::thread> workers;
+    for (int i = 0; i < num_chunks; i++)
+    {
+        workers.emplace_back([&cuts, &odd_quotes, i]()
+                             { odd_quotes[i] = std::count(cuts[i], cuts[i + 1], '"') % 2; });
+    }
+    for (int i = 0; i < workers.size(); i++)
+    {
+        workers[i].join();
+    }
+
+    // move every inner cut to just after the first newline outside quotes
+    vector<const char *> bounds;
+    bounds.push_back(begin);
+    bool in_quotes = false;
+
+    for (int i = 1; i < num_chunks; i++)
+    {
+        in_quotes = (in_quotes != (odd_quotes[i - 1] == 1));
+
+        // start from the nominal cut, unless the previous chunk already runs past it
+        bool q = in_quotes;
+        const char *p = cuts[i];
+        if (bounds.back() > p)
         {
-            s.ui = stoi(token, 0);
+            p = bounds.back();
+            q = false;
         }
 
-        // english score
-        if (!std::getline(ss, token, ',')) 
+        while (p < end && (*p != '\n' || q))
         {
-            s.english = 0;
-        } 
-        else 
+            if (*p == '"')
+            {
+                q = !q;
+            }
+            p++;
+        }
+
+        if (p < end)
         {
-            s.english = stoi(token, 0);
+            p++;
         }
-        
-        // intializing values
-        s.student_score = 0;
-        s.x = 0.0;
-        s.y = 0.0;
-        s.selected = false;
 
-        students.push_back(s);
-        line_no++;
+        // a tiny chunk can be swallowed whole by the previous one's row, just skip the cut then
+        if (p > bounds.back() && p < end)
+        {
+            bounds.push_back(p);
+        }
     }
 
-    // success message & close the file
+    bounds.push_back(end);
+    return bounds;
+}
 
-    file.close();
+/**
+ * load students from CSV file. the file is memory mapped and parsed in place, so there is no
+ * per-line string, stringstream or exception. with num_threads != 1 the rows are split into
+ * chunks and parsed on several cores (0 = one per core), the result is identical either way.
+ * a fresh binary snapshot next to the csv is used instead of parsing when there is one.
+ * students come back scored with the default rubric either way (the snapshot keeps the scores)
+ */
+std::vector<student> load_students_from_csv(const std::string &filename, int num_threads, bool for_diff, std::vector<team> *teams)
+{
+    std::vector<student> students;
+    mapped_file file;
+
+    // error handling
+    if (!map_file(filename, file))
+    {
+        write_line("Error: Could not open file: " + filename);
+        return students;
+    }
+
+    const char *begin = file.data;
+    const char *end = file.data + file.size;
+
+    // use the binary snapshot next to the csv if it was made from exactly this file
+    string snapshot_path = snapshot_path_for(filename);
+    csv_fingerprint fingerprint;
+    bool have_fingerprint = !for_diff && fingerprint_csv(filename, file.data, file.size, fingerprint);
+
+    if (have_fingerprint && read_cohort_snapshot(snapshot_path, fingerprint, students, teams))
+    {
+        unmap_file(file);
+        write_line("Loaded " + std::to_string(students.size()) + " students from " + filename + " (snapshot)");
+        return students;
+    }
+
+    // the first line is the headers, turn it into a plan once and start the rows after it
+    const char *header_end = nullptr;
+    if (begin != end)
+    {
+        header_end = (const char *)std::memchr(begin, '\n', end - begin);
+    }
+
+    if (header_end == nullptr)
+    {
+        header_end = end;
+    }
+
+    csv_parse_plan plan = build_csv_parse_plan(begin, header_end);
+    begin = header_end + (header_end < end ? 1 : 0);
+
+    // decide how many chunks, small files aren't worth starting threads for
+    if (num_threads <= 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    const size_t MIN_CHUNK_BYTES = 1 << 20;
+    size_t max_chunks = (end - begin) / MIN_CHUNK_BYTES + 1;
+    if (num_threads > max_chunks)
+    {
+        num_threads = max_chunks;
+    }
+
+    vector<const char *> bounds;
+    if (num_threads > 1)
+    {
+        bounds = split_csv_chunks(begin, end, num_threads);
+    }
+    else
+    {
+        bounds.push_back(begin);
+        bounds.push_back(end);
+    }
+
+    // parse every chunk into its own buffer
+    int chunk_count = bounds.size() - 1;
+    vector<csv_chunk_result> chunks(chunk_count);
+
+    if (chunk_count == 1)
+    {
+        parse_student_rows(bounds[0], bounds[1], plan, chunks[0]);
+    }
+    else
+    {
+        vector<std::thread> workers;
+        for (int i = 0; i < chunk_count; i++)
+        {
+            workers.emplace_back([&bounds, &plan, &chunks, i]()
+                                 { parse_student_rows(bounds[i], bounds[i + 1], plan, chunks[i]); });
+        }
+        for (int i = 0; i < workers.size(); i++)
+        {
+            workers[i].join();
+        }
+    }
+
+    // category codes are private to each chunk until now, merging in file order keeps the codes in order of first appearance
+    use_category_columns(plan.category_names);
+    int slots = 0;
+    for (int i = 0; i < chunk_count; i++)
+    {
+        merge_category_codes(chunks[i].students, 0, chunks[i].students.size(), chunks[i].categories);
+        slots = std::max(slots, chunks[i].slots);
+    }
+
+    // the grid is as wide as the widest availability cell
+    set_availability_slots(slots);
+
+    // join chunks in file order, numbering lines from the header (line 1)
+    size_t total = 0;
+    for (int i = 0; i < chunk_count; i++)
+    {
+        total += chunks[i].students.size();
+    }
+
+    if (chunk_count == 1)
+    {
+        students.swap(chunks[0].students);
+    }
+    else
+    {
+        students.reserve(total);
+    }
+
+    // a very dirty export could have thousands of problems, only print the first few
+    const int MAX_PRINTED_DIAGNOSTICS = 20;
+    int diagnostic_count = 0;
+
+    int first_line = 2;
+    for (int i = 0; i < chunk_count; i++)
+    {
+        for (int d = 0; d < chunks[i].diagnostics.size(); d++)
+        {
+            const csv_diagnostic &diag = chunks[i].diagnostics[d];
+            if (diagnostic_count < MAX_PRINTED_DIAGNOSTICS)
+            {
+                write_line("CSV line " + std::to_string(first_line + diag.line) + ": " + diag.message);
+            }
+            diagnostic_count++;
+        }
+
+        if (chunk_count > 1)
+        {
+            std::move(chunks[i].students.begin(), chunks[i].students.end(), std::back_inserter(students));
+            vector<student>().swap(chunks[i].students);
+        }
+
+        first_line += chunks[i].line_count;
+    }
+
+    if (diagnostic_count > MAX_PRINTED_DIAGNOSTICS)
+    {
+        write_line("... and " + std::to_string(diagnostic_count - MAX_PRINTED_DIAGNOSTICS) + " more CSV problems.");
+    }
+
+    // every student remembers its row so teams can always be traced back to the cohort
+    for (int i = 0; i < students.size(); i++)
+    {
+        students[i].id = i;
+    }
+
+    // score everyone now, so the snapshot stores real scores and a load from it needs no scoring pass
+    // (a reload being diffed scores only the rows that changed)
+    if (!for_diff)
+    {
+        compute_scores_with_rubric(students, default_rubric());
+    }
+
+    // save a snapshot so the next load skips parsing (not being able to write one is fine)
+    if (have_fingerprint)
+    {
+        write_cohort_snapshot(snapshot_path, fingerprint, students, nullptr);
+    }
+
+    // success message & close the file
+    unmap_file(file);
     write_line("Loaded " + std::to_string(students.size()) + " students from " + filename);
     return students;
 }
+
+/**
+ * the snapshot is keyed on the csv as it is now, so the file is fingerprinted again before writing
+ */
+bool save_allocation_snapshot(const std::string &filename, const std::vector<student> &students, const std::vector<team> &teams)
+{
+    mapped_file file;
+    if (!map_file(filename, file))
+    {
+        return false;
+    }
+
+    csv_fingerprint fingerprint;
+    bool ok = fingerprint_csv(filename, file.data, file.size, fingerprint) &&
+              write_cohort_snapshot(snapshot_path_for(filename), fingerprint, students, &teams);
+    unmap_file(file);
+    return ok;
+}
+
+/**
+ * open a csv for reading a batch of rows at a time (the header is read into the plan straight away)
+ */
+bool open_csv_rows(const std::string &filename, csv_row_reader &reader)
+{
+    // error handling
+    if (!map_file(filename, reader.file))
+    {
+        write_line("Error: Could not open file: " + filename);
+        return false;
+    }
+
+    const char *begin = reader.file.data;
+    const char *end = reader.file.data + reader.file.size;
+
+    const char *header_end = nullptr;
+    if (begin != end)
+    {
+        header_end = (const char *)std::memchr(begin, '\n', end - begin);
+    }
+
+    if (header_end == nullptr)
+    {
+        header_end = end;
+    }
+
+    reader.plan = build_csv_parse_plan(begin, header_end);
+    use_category_columns(reader.plan.category_names);
+    set_availability_slots(0);
+    reader.pos = header_end + (header_end < end ? 1 : 0);
+    reader.end = end;
+    reader.next_line = 2;
+    reader.rows_read = 0;
+    reader.diagnostic_count = 0;
+    return true;
+}
+
+/**
+ * parse the next max_rows rows (or whatever is left) into batch, ids carry on from the last batch
+ */
+bool read_csv_rows(csv_row_reader &reader, size_t max_rows, vector<student> &batch)
+{
+    batch.clear();
+    if (reader.pos >= reader.end)
+    {
+        return false;
+    }
+
+    // find where this batch stops, always on a row boundary
+    const char *cut = reader.pos;
+    for (size_t rows = 0; rows < max_rows && cut < reader.end; rows++)
+    {
+        bool has_quotes = false;
+        int extra_lines = 0;
+        const char *row_end = find_row_end(cut, reader.end, has_quotes, extra_lines);
+        cut = row_end + (row_end < reader.end ? 1 : 0);
+    }
+
+    csv_chunk_result result;
+    parse_student_rows(reader.pos, cut, reader.plan, result);
+    merge_category_codes(result.students, 0, result.students.size(), result.categories);
+
+    // the grid only ever widens as batches come in
+    if (result.slots > availability_slots())
+    {
+        set_availability_slots(result.slots);
+    }
+
+    // same capped reporting as load_students_from_csv
+    const int MAX_PRINTED_DIAGNOSTICS = 20;
+    for (int d = 0; d < result.diagnostics.size(); d++)
+    {
+        if (reader.diagnostic_count < MAX_PRINTED_DIAGNOSTICS)
+        {
+            write_line("CSV line " + std::to_string(reader.next_line + result.diagnostics[d].line) + ": " + result.diagnostics[d].message);
+        }
+        reader.diagnostic_count++;
+    }
+
+    for (int i = 0; i < result.students.size(); i++)
+    {
+        result.students[i].id = reader.rows_read + i;
+    }
+
+    reader.rows_read += result.students.size();
+    reader.next_line += result.line_count;
+    reader.pos = cut;
+    batch.swap(result.students);
+    return true;
+}
+
+/**
+ * release the mapping behind a row reader
+ */
+void close_csv_rows(csv_row_reader &reader)
+{
+    unmap_file(reader.file);
+}
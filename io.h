@@ -1,6 +1,7 @@
 // importing libraries
 #pragma once
 #include "structs.h"
+#include "mapped_file.h"
 #include <vector>
 #include <string>
 
@@ -8,8 +9,97 @@ using std::vector;
 using std::string;
 
 
+// which student field a CSV column feeds
+enum csv_field
+{
+    FIELD_SKIP = -1,
+    FIELD_NAME,
+    FIELD_LEADERSHIP,
+    FIELD_FRONTEND,
+    FIELD_BACKEND,
+    FIELD_SECURITY,
+    FIELD_UI,
+    FIELD_ENGLISH,
+    FIELD_AVAILABILITY,
+    FIELD_CATEGORY // categorical column c is FIELD_CATEGORY + c
+};
+
+// the header compiled into a column -> field lookup, built once per file
+struct csv_parse_plan
+{
+    vector<int> columns; // csv_field for every column in the header
+    int last_needed;     // last column that isn't FIELD_SKIP (rows are not scanned past it)
+    vector<string> category_names; // headers marked "(category)", in column order
+};
+
+// highest value a skill cell can hold (0 means missing)
+const int SKILL_MAX = 10;
+
+// outcome of parsing one numeric cell
+enum parse_status
+{
+    PARSE_OK,
+    PARSE_BLANK,
+    PARSE_INVALID,
+    PARSE_OUT_OF_RANGE
+};
+
 std::string trim_string(const std::string &s);
 
+// Parse a whole (trimmed) cell as an int without allocating or throwing. value is only set on PARSE_OK.
+parse_status parse_int_field(const char *begin, const char *end, int &value);
+
+// Parse a skill cell (0-10). Out of range values are clamped into value and reported as PARSE_OUT_OF_RANGE.
+parse_status parse_skill_field(const char *begin, const char *end, int &value);
+
+// Whole-string integer parse that returns fallback instead of throwing.
 int safe_stoi(const std::string &token, int fallback);
 
-vector<student> load_students_from_csv(const string &filename);
+// The fixed Name, Leadership, Frontend, Backend, Security, UI/UX, English layout.
+csv_parse_plan default_csv_parse_plan();
+
+// Build a plan from a header line (tolerates "(1-10)" suffixes, skips unknown columns,
+// reads columns marked "(category)" as categorical).
+csv_parse_plan build_csv_parse_plan(const char *begin, const char *end);
+
+/**
+ * Load students from a CSV file. The header line decides which column is which. num_threads > 1
+ * parses chunks of the file on that many cores, 0 uses every core. Problems are
+ * reported with their file line number. Students come back scored with default_rubric, and
+ * the snapshot written next to the csv keeps those scores.
+ * for_diff is for a live reload that apply_cohort_changes diffs against the cohort it has: the snapshot
+ * is neither read nor written and the rows come back unscored (only the changed ones get scored there).
+ * teams, if given, gets the allocation stored by save_allocation_snapshot when the snapshot is fresh
+ * (left alone otherwise).
+ */
+vector<student> load_students_from_csv(const string &filename, int num_threads = 1, bool for_diff = false, vector<team> *teams = nullptr);
+
+/**
+ * Rewrite the snapshot next to a csv with the current allocation, so the next load of the unchanged
+ * file gets the teams back. students have to be the file's rows in file order, scored.
+ *
+ * @returns false if the csv couldn't be read or the snapshot couldn't be written
+ */
+bool save_allocation_snapshot(const string &filename, const vector<student> &students, const vector<team> &teams);
+
+
+// reads a csv a batch of rows at a time, for cohorts that are too big to hold as one vector
+struct csv_row_reader
+{
+    mapped_file file;
+    csv_parse_plan plan;
+    const char *pos;      // start of the next unread row
+    const char *end;
+    int next_line;        // file line number of pos
+    long long rows_read;  // used to give every student a cohort-wide id
+    int diagnostic_count;
+};
+
+// Open a csv and read its header. Prints an error and returns false if it can't be opened.
+bool open_csv_rows(const string &filename, csv_row_reader &reader);
+
+// Parse up to max_rows more students into batch. Returns false once the file is exhausted.
+bool read_csv_rows(csv_row_reader &reader, size_t max_rows, vector<student> &batch);
+
+// Release the file behind a reader.
+void close_csv_rows(csv_row_reader &reader);
@@ -2,12 +2,20 @@
 #include "structs.h"
 #include "splashkit.h"
 #include "ui.h"
+#include "streaming.h"
 #include <string>
 #include <sstream>
 
 // main function
-int main()
+int main(int argc, char *argv[])
 {
+    // --stream and --synthetic run without a window
+    int batch_code = run_batch_command(argc, argv);
+    if (batch_code != -1)
+    {
+        return batch_code;
+    }
+
     // create UIContext object
     UIContext ctx;
 
@@ -0,0 +1,161 @@
+// including relevant libraries (kept away from splashkit.h so the OS headers don't clash with it)
+#include "mapped_file.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * reset a mapping to the "nothing mapped" state
+ */
+static void clear_mapping(mapped_file &m)
+{
+    m.data = nullptr;
+    m.size = 0;
+    m.file_handle = nullptr;
+    m.map_handle = nullptr;
+    m.fd = -1;
+}
+
+#ifdef _WIN32
+
+/**
+ * map a file using the win32 file mapping api
+ */
+bool map_file(const std::string &filename, mapped_file &out)
+{
+    clear_mapping(out);
+
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    out.file_handle = file;
+
+    // nothing to map for an empty file
+    if (size.QuadPart == 0)
+    {
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (mapping == nullptr)
+    {
+        unmap_file(out);
+        return false;
+    }
+    out.map_handle = mapping;
+
+    void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    if (view == nullptr)
+    {
+        unmap_file(out);
+        return false;
+    }
+
+    out.data = (const char *)view;
+    out.size = (size_t)size.QuadPart;
+    return true;
+}
+
+/**
+ * unmap and close everything map_file opened
+ */
+void unmap_file(mapped_file &m)
+{
+    if (m.data != nullptr)
+    {
+        UnmapViewOfFile(m.data);
+    }
+
+    if (m.map_handle != nullptr)
+    {
+        CloseHandle((HANDLE)m.map_handle);
+    }
+
+    if (m.file_handle != nullptr)
+    {
+        CloseHandle((HANDLE)m.file_handle);
+    }
+
+    clear_mapping(m);
+}
+
+#else
+
+/**
+ * map a file using mmap
+ */
+bool map_file(const std::string &filename, mapped_file &out)
+{
+    clear_mapping(out);
+
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    out.fd = fd;
+
+    // nothing to map for an empty file
+    if (st.st_size == 0)
+    {
+        return true;
+    }
+
+    void *view = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (view == MAP_FAILED)
+    {
+        unmap_file(out);
+        return false;
+    }
+
+    // we read front to back, so let the kernel read ahead aggressively
+    madvise(view, st.st_size, MADV_SEQUENTIAL);
+
+    out.data = (const char *)view;
+    out.size = st.st_size;
+    return true;
+}
+
+/**
+ * unmap and close everything map_file opened
+ */
+void unmap_file(mapped_file &m)
+{
+    if (m.data != nullptr)
+    {
+        munmap((void *)m.data, m.size);
+    }
+
+    if (m.fd >= 0)
+    {
+        close(m.fd);
+    }
+
+    clear_mapping(m);
+}
+
+#endif
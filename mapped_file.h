@@ -0,0 +1,29 @@
+// including relevant libraries
+#pragma once
+#include <string>
+#include <cstddef>
+
+// a read-only view of a whole file mapped into memory
+struct mapped_file
+{
+    const char *data;
+    size_t size;
+    // platform handles (only used by map_file and unmap_file)
+    void *file_handle;
+    void *map_handle;
+    int fd;
+};
+
+/**
+ * Map a whole file read-only. Empty files succeed with data == nullptr and size == 0.
+ *
+ * @param filename the file to map
+ * @param out the mapping (only valid if this returns true)
+ * @returns true if the file could be opened and mapped
+ */
+bool map_file(const std::string &filename, mapped_file &out);
+
+/**
+ * Release a mapping made by map_file (safe to call twice).
+ */
+void unmap_file(mapped_file &m);
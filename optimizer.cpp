@@ -1,96 +1,543 @@
 #include "optimizer.h"
-#include <cmath>
+#include "allocator.h"
+#include "incremental.h"
+#include "roles.h"
+#include "scoring.h"
+#include "categories.h"
+#include "availability.h"
 #include <string>
+#include <algorithm>
+#include <cstdlib>
 
 using std::vector;
 using std::to_string;
 
-// compute mean of integers in vector
-double mean_int_vector(const vector<int> &vals)
+// a penalty for each role a team is missing (in variance units of whole points)
+const long long ROLE_PENALTY = 1000;
+
+// k * sum(t^2) - (sum t)^2, which is k^2 * variance of the team totals but stays an exact integer
+long long team_spread_metric(const vector<team> &teams)
 {
-    if (vals.empty()) 
+    long long k = teams.size();
+    long long sum = 0;
+    long long sum_sq = 0;
+
+    // loop thru all teams and accumulate totals and squared totals
+    for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
     {
-        return 0.0;
+        long long t = teams[teamIdx].total_score;
+        sum += t;
+        sum_sq += t * t;
     }
 
-    double sum = 0.0;
+    return k * sum_sq - sum * sum;
+}
+
+// same as team_spread_metric for each skill lane, summed and scaled to the fixed point units
+long long skill_spread_metric(const vector<team> &teams)
+{
+    long long k = teams.size();
+    long long metric = 0;
 
-    for (int vi = 0; vi < vals.size(); vi++)
+    for (int l = 0; l < SKILL_LANES; l++)
     {
-        sum += vals[vi];
-    } 
+        long long sum = 0;
+        long long sum_sq = 0;
+        for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
+        {
+            long long t = teams[teamIdx].skill_totals[l];
+            sum += t;
+            sum_sq += t * t;
+        }
+        metric += k * sum_sq - sum * sum;
+    }
 
-    return (sum / vals.size());
+    return metric * SCORE_SCALE * SCORE_SCALE;
 }
 
-// compute variance of integers in vector
-double variance_int_vector(const vector<int> &vals)
+// sum over the lanes of d * (gap + d) with d = b - a, the per-skill version of the swap delta
+// (the caller multiplies by 2k). a fixed 8 lanes with no branches, so it compiles to a few vector ops
+static inline long long lane_swap_delta(const int *a, const int *b, const long long *gap)
 {
-    if (vals.empty()) 
+    long long acc = 0;
+    for (int l = 0; l < SKILL_LANES; l++)
     {
-        return 0.0;
+        long long d = b[l] - a[l];
+        acc += d * (gap[l] + d);
+    }
+    return acc;
+}
+
+// tA - tB for every skill lane of a team pair
+static inline void lane_gaps(const team &A, const team &B, long long gap[SKILL_LANES])
+{
+    for (int l = 0; l < SKILL_LANES; l++)
+    {
+        gap[l] = (long long)A.skill_totals[l] - B.skill_totals[l];
     }
+}
 
-    double mean_value = mean_int_vector(vals);
+// penalty for one missing role, scaled to the same units as team_spread_metric
+long long role_penalty_units(int team_count)
+{
+    long long k = team_count;
+    return ROLE_PENALTY * SCORE_SCALE * SCORE_SCALE * k * k;
+}
 
-    double accum = 0.0; // accumulator for squared differences
+// k * sum(c^2) - (sum c)^2 over the teams for every value of every categorical column, so a value
+// spread in proportion to the teams costs nothing. scaled to metric units by CATEGORY_PENALTY
+long long category_spread_metric(const vector<team> &teams)
+{
+    const vector<category_column> &categories = category_columns();
+    long long k = teams.size();
+    long long metric = 0;
 
-    // loop thru all elements
-    for (int vi = 0; vi < vals.size(); vi++)
+    for (int c = 0; c < categories.size(); c++)
     {
-        double diff = vals[vi] - mean_value; // difference from mean
-        accum += diff * diff; // add squared difference 
+        for (int v = 0; v < categories[c].values.size(); v++)
+        {
+            long long sum = 0;
+            long long sum_sq = 0;
+            for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
+            {
+                long long n = teams[teamIdx].category_counts[c][v];
+                sum += n;
+                sum_sq += n * n;
+            }
+            metric += k * sum_sq - sum * sum;
+        }
     }
 
-    // return average square difference
-    return accum / vals.size();
+    return metric * CATEGORY_PENALTY * SCORE_SCALE * SCORE_SCALE;
 }
 
-// compute balance metric described in plan
-double compute_balance_metric(const vector<team> &teams)
+// change in the category term when sa (in A) and sb (in B) swap. the column sums don't move, and a
+// column where both hold the same value doesn't change at all. the caller multiplies by 2k * penalty
+static inline long long category_swap_delta(const team &A, const team &B, const student &sa, const student &sb, int columns)
 {
-    // vector to store total scores fo all teams
-    vector<int> totals;
+    long long acc = 0;
+    for (int c = 0; c < columns; c++)
+    {
+        int va = sa.category[c];
+        int vb = sb.category[c];
+        if (va != vb)
+        {
+            acc += B.category_counts[c][va] - A.category_counts[c][va] + A.category_counts[c][vb] - B.category_counts[c][vb] + 2;
+        }
+    }
+    return acc;
+}
+
+// penalty for one common slot short of the target, in the same units as the role penalty
+long long availability_penalty_units(int team_count)
+{
+    long long k = team_count;
+    return AVAILABILITY_PENALTY * SCORE_SCALE * SCORE_SCALE * k * k;
+}
 
-    // loop thru all teams and collect total scores
+// common slots every team is short of the target, summed (0 without an availability column)
+int total_slots_short(const vector<team> &teams)
+{
+    int target = availability_target();
+    if (target == 0)
+    {
+        return 0;
+    }
+
+    unsigned long long slot_mask = availability_slot_mask();
+    int total = 0;
     for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
     {
-        totals.push_back(teams[teamIdx].total_score);
+        total += slots_short(team_common_slots(teams[teamIdx]), slot_mask, target);
     }
+    return total;
+}
 
-    // compute variance of team totals
-    double var = variance_int_vector(totals);
+// the extreme modes' term for totals whose highest is hi and lowest is lo, squared so it is in the
+// same units as k * sum(t^2) - (sum t)^2
+static inline long long extreme_term(long long hi, long long lo, long long k, long long sum, balance_mode mode)
+{
+    long long x = (mode == BALANCE_RANGE) ? k * (hi - lo) : std::max(k * hi - sum, sum - k * lo);
+    return x * x;
+}
+
+// number of required roles a coverage mask is missing
+static inline int missing_roles(unsigned required, unsigned cover)
+{
+    return __builtin_popcount(required & ~cover);
+}
+
+// compute balance metric described in plan
+long long compute_balance_metric(const vector<team> &teams, balance_mode mode)
+{
+    // spread of team totals (scaled variance)
+    long long spread = (mode == BALANCE_SKILLS) ? skill_spread_metric(teams) : team_spread_metric(teams);
+
+    // the extreme modes put the worst team on top of that
+    if (extreme_mode(mode) && !teams.empty())
+    {
+        long long hi = teams[0].total_score;
+        long long lo = teams[0].total_score;
+        long long sum = 0;
+        for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
+        {
+            hi = std::max(hi, teams[teamIdx].total_score);
+            lo = std::min(lo, teams[teamIdx].total_score);
+            sum += teams[teamIdx].total_score;
+        }
+        spread += extreme_term(hi, lo, teams.size(), sum, mode);
+    }
 
-    // count teams missing leaders
+    // count the roles each team is missing (just the leader unless the roles sidecar adds more)
+    unsigned required = required_roles();
     int missing = 0;
 
-    // check every team to see if they have a leader or not
     for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
     {
-        if (!teams[teamIdx].hasLeader) 
+        missing += missing_roles(required, team_coverage(teams[teamIdx]));
+    }
+
+    // combine spread, categories and penalties. a penalty is k^2 scaled, so a role rule scarcer than the
+    // teams (tens of thousands missing it at k = 100k) overflows 64 bits: sum in 128 and saturate
+    __int128 metric = (__int128)spread + category_spread_metric(teams) + (__int128)role_penalty_units(teams.size()) * missing +
+                      (__int128)availability_penalty_units(teams.size()) * total_slots_short(teams);
+
+    // return metric
+    return (metric > METRIC_SATURATION) ? METRIC_SATURATION : (long long)metric;
+}
+
+// convert a metric (or delta) back to variance in whole points for display
+double metric_to_variance(long long metric, int team_count)
+{
+    if (team_count <= 0)
+    {
+        return 0.0;
+    }
+
+    double k = team_count;
+    return metric / (k * k * SCORE_SCALE * SCORE_SCALE);
+}
+
+// gather the per-pair parts of the swap delta
+void begin_pair_delta(pair_delta_context &ctx, const vector<team> &teams, int a, int b, balance_mode mode, const total_extremes *extremes)
+{
+    const team &A = teams[a];
+    const team &B = teams[b];
+
+    ctx.k = teams.size();
+    ctx.mode = mode;
+    ctx.total_gap = A.total_score - B.total_score;
+    lane_gaps(A, B, ctx.gap);
+
+    ctx.required = required_roles();
+    ctx.cover_a = team_coverage(A);
+    ctx.cover_b = team_coverage(B);
+    ctx.sole_a = team_sole_roles(A);
+    ctx.sole_b = team_sole_roles(B);
+    ctx.missing_before = missing_roles(ctx.required, ctx.cover_a) + missing_roles(ctx.required, ctx.cover_b);
+    ctx.penalty = role_penalty_units(teams.size());
+
+    ctx.team_a = &A;
+    ctx.team_b = &B;
+    ctx.categories = category_count();
+    ctx.category_units = 2 * ctx.k * CATEGORY_PENALTY * SCORE_SCALE * SCORE_SCALE;
+
+    // which slots each team is free in all together, and all but one
+    ctx.slot_target = availability_target();
+    if (ctx.slot_target > 0)
+    {
+        ctx.slot_mask = availability_slot_mask();
+        ctx.common_a = team_common_slots(A);
+        ctx.common_b = team_common_slots(B);
+        ctx.near_a = slots_with_count(A, A.members.size() - 1);
+        ctx.near_b = slots_with_count(B, B.members.size() - 1);
+        ctx.short_before = slots_short(ctx.common_a, ctx.slot_mask, ctx.slot_target) + slots_short(ctx.common_b, ctx.slot_mask, ctx.slot_target);
+        ctx.slot_penalty = availability_penalty_units(teams.size());
+    }
+
+    // a swap only moves the totals of a and b, so the rest of the teams just need their extremes
+    ctx.total_a = A.total_score;
+    ctx.total_b = B.total_score;
+    if (extreme_mode(mode))
+    {
+        ctx.has_others = false;
+        if (extremes != nullptr)
         {
-            missing++;
+            int high = heap_best_excluding(*extremes->highest, teams, a, b);
+            int low = heap_best_excluding(*extremes->lowest, teams, a, b);
+            ctx.has_others = (high != -1 && low != -1);
+            if (ctx.has_others)
+            {
+                ctx.others_high = teams[high].total_score;
+                ctx.others_low = teams[low].total_score;
+            }
+            ctx.total_sum = extremes->sum;
         }
+        else
+        {
+            ctx.total_sum = 0;
+            for (int t = 0; t < teams.size(); t++)
+            {
+                ctx.total_sum += teams[t].total_score;
+                if (t == a || t == b)
+                {
+                    continue;
+                }
+                if (!ctx.has_others)
+                {
+                    ctx.others_high = ctx.others_low = teams[t].total_score;
+                    ctx.has_others = true;
+                }
+                ctx.others_high = std::max(ctx.others_high, teams[t].total_score);
+                ctx.others_low = std::min(ctx.others_low, teams[t].total_score);
+            }
+        }
+
+        long long hi = std::max(A.total_score, B.total_score);
+        long long lo = std::min(A.total_score, B.total_score);
+        if (ctx.has_others)
+        {
+            hi = std::max(hi, ctx.others_high);
+            lo = std::min(lo, ctx.others_low);
+        }
+        ctx.extreme_before = extreme_term(hi, lo, ctx.k, ctx.total_sum, mode);
     }
+}
 
-    // a penalty for missing leaders
-    const double LEADER_PENALTY = 1000.0; 
+// the spread (and extreme) part of the delta when team a gains d points and team b loses them.
+// the sum of all totals stays the same so only the k * sum(t^2) part of the metric moves
+static inline long long pair_spread_delta(const pair_delta_context &ctx, long long d)
+{
+    long long delta = ctx.k * (2 * d * ctx.total_gap + 2 * d * d);
 
-    // combine variance and penalty
-    double metric = var + LEADER_PENALTY * missing;
+    // new extremes are the two moved totals against the other teams' extremes
+    if (extreme_mode(ctx.mode))
+    {
+        long long ta = ctx.total_a + d;
+        long long tb = ctx.total_b - d;
+        long long hi = std::max(ta, tb);
+        long long lo = std::min(ta, tb);
+        if (ctx.has_others)
+        {
+            hi = std::max(hi, ctx.others_high);
+            lo = std::min(lo, ctx.others_low);
+        }
+        delta += extreme_term(hi, lo, ctx.k, ctx.total_sum, ctx.mode) - ctx.extreme_before;
+    }
+    return delta;
+}
 
-    // return metric
-    return metric;
+// spread part plus the roles, categories and slots. roles after the swap come straight from the team masks
+long long pair_swap_delta(const pair_delta_context &ctx, const student &sa, const student &sb)
+{
+    long long delta;
+    if (ctx.mode == BALANCE_SKILLS)
+    {
+        int lanes_a[SKILL_LANES];
+        int lanes_b[SKILL_LANES];
+        student_skill_lanes(sa, lanes_a);
+        student_skill_lanes(sb, lanes_b);
+        delta = 2 * ctx.k * SCORE_SCALE * SCORE_SCALE * lane_swap_delta(lanes_a, lanes_b, ctx.gap);
+    }
+    else
+    {
+        delta = pair_spread_delta(ctx, sb.student_score - sa.student_score);
+    }
+
+    int missing_after = missing_roles(ctx.required, coverage_after_swap(ctx.cover_a, ctx.sole_a, sa.roles, sb.roles)) +
+                        missing_roles(ctx.required, coverage_after_swap(ctx.cover_b, ctx.sole_b, sb.roles, sa.roles));
+
+    if (ctx.categories > 0)
+    {
+        delta += ctx.category_units * category_swap_delta(*ctx.team_a, *ctx.team_b, sa, sb, ctx.categories);
+    }
+
+    // common slots after the swap come from the masks the same way role coverage does
+    if (ctx.slot_target > 0)
+    {
+        int short_after = slots_short(common_after_swap(ctx.common_a, ctx.near_a, sa.availability, sb.availability), ctx.slot_mask, ctx.slot_target) +
+                          slots_short(common_after_swap(ctx.common_b, ctx.near_b, sb.availability, sa.availability), ctx.slot_mask, ctx.slot_target);
+        delta += ctx.slot_penalty * (short_after - ctx.short_before);
+    }
+
+    return delta + ctx.penalty * (missing_after - ctx.missing_before);
+}
+
+long long swap_metric_delta(const vector<team> &teams, int a, int ia, int b, int ib, balance_mode mode)
+{
+    pair_delta_context ctx;
+    begin_pair_delta(ctx, teams, a, b, mode);
+    return pair_swap_delta(ctx, teams[a].members[ia], teams[b].members[ib]);
+}
+
+// what a swap moves between two teams: the score, or the summed skills in per-skill mode
+static inline long long swap_key(const student &s, bool by_skill)
+{
+    if (!by_skill)
+    {
+        return s.student_score;
+    }
+    int lanes[SKILL_LANES];
+    student_skill_lanes(s, lanes);
+    long long sum = 0;
+    for (int l = 0; l < SKILL_LANES; l++)
+    {
+        sum += lanes[l];
+    }
+    return sum;
+}
+
+// a team's members by swap key, lowest first (O(m log m))
+struct member_order
+{
+    vector<long long> key;
+    vector<int> member;
+};
+
+static void sort_members(const team &T, bool by_skill, member_order &order)
+{
+    int size = T.members.size();
+    vector<std::pair<long long, int>> keyed(size);
+    for (int m = 0; m < size; m++)
+    {
+        keyed[m] = {swap_key(T.members[m], by_skill), m};
+    }
+    std::sort(keyed.begin(), keyed.end());
+
+    order.key.resize(size);
+    order.member.resize(size);
+    for (int m = 0; m < size; m++)
+    {
+        order.key[m] = keyed[m].first;
+        order.member[m] = keyed[m].second;
+    }
+}
+
+// Two pointers over a member_order, from the key nearest target / 2 outwards, so the distance
+// |2 * key - target| never goes down. target is twice the key that evens the pair out
+// (2 * key of the member leaving a, minus the gap between the teams)
+struct nearest_walk
+{
+    const member_order *order;
+    long long target;
+    int down; // next position below target / 2, -1 when done
+    int up;   // next position at or above it, size when done
+};
+
+static void begin_walk(nearest_walk &w, const member_order &order, long long target)
+{
+    w.order = &order;
+    w.target = target;
+    w.up = std::lower_bound(order.key.begin(), order.key.end(), target, [](long long key, long long t)
+                            { return 2 * key < t; }) - order.key.begin();
+    w.down = w.up - 1;
+}
+
+// next position of the walk (-1 once every member was visited), distance is set to |2 * key - target|
+static inline int walk_next(nearest_walk &w, long long &distance)
+{
+    const vector<long long> &key = w.order->key;
+    bool has_down = (w.down >= 0);
+    bool has_up = (w.up < key.size());
+    if (!has_down && !has_up)
+    {
+        return -1;
+    }
+
+    long long below = has_down ? w.target - 2 * key[w.down] : 0;
+    long long above = has_up ? 2 * key[w.up] - w.target : 0;
+    if (has_down && (!has_up || below <= above))
+    {
+        distance = below;
+        return w.down--;
+    }
+    distance = above;
+    return w.up++;
+}
+
+// lowest the per-skill spread part can be for a swap at this distance from the pair's even point.
+// the lane delta is 2k * S^2 * (sum (2d + g)^2 - sum g^2) / 4, and sum (2d + g)^2 >= distance^2 / skills
+// (the padding lanes are 0 on both sides)
+static inline long long lane_spread_floor(long long distance, long long gap_sq, long long k)
+{
+    long long spread_sq = (distance * distance + NUM_SKILLS - 1) / NUM_SKILLS;
+    long long x = 2 * k * SCORE_SCALE * SCORE_SCALE * (spread_sq - gap_sq);
+    return x >= 0 ? x / 4 : -((-x + 3) / 4);
+}
+
+// lowest the category part of any swap between A and B can go, per column the most a value held in A
+// gains by moving to B plus the most a value held in B gains by moving to A (caller multiplies by 2k * penalty)
+static long long category_floor(const team &A, const team &B, int columns)
+{
+    long long acc = 0;
+    for (int c = 0; c < columns; c++)
+    {
+        bool found_a = false;
+        bool found_b = false;
+        long long best_a = 0;
+        long long best_b = 0;
+        for (int v = 0; v < MAX_CATEGORY_VALUES; v++)
+        {
+            long long moved = B.category_counts[c][v] - A.category_counts[c][v];
+            if (A.category_counts[c][v] > 0 && (!found_a || moved < best_a))
+            {
+                best_a = moved;
+                found_a = true;
+            }
+            if (B.category_counts[c][v] > 0 && (!found_b || -moved < best_b))
+            {
+                best_b = -moved;
+                found_b = true;
+            }
+        }
+        if (found_a && found_b)
+        {
+            acc += std::min(0LL, best_a + best_b + 2);
+        }
+    }
+    return acc;
+}
+
+// lowest the roles, categories and slots can take any swap of the pair: every missing role and slot fixed
+static long long pair_extra_floor(const pair_delta_context &ctx)
+{
+    long long lowest = -ctx.penalty * ctx.missing_before;
+    if (ctx.categories > 0)
+    {
+        lowest += ctx.category_units * category_floor(*ctx.team_a, *ctx.team_b, ctx.categories);
+    }
+    if (ctx.slot_target > 0)
+    {
+        lowest -= ctx.slot_penalty * ctx.short_before;
+    }
+    return lowest;
+}
+
+// true if x goes before y in the suggestion list: lower delta, then the order the full scan finds them in
+// (team a, team b, member of a, member of b), so the list doesn't depend on which pairs were looked at first
+static inline bool suggestion_before(const SwapSuggestion &x, const SwapSuggestion &y)
+{
+    if (x.delta != y.delta) return x.delta < y.delta;
+    if (x.teamA != y.teamA) return x.teamA < y.teamA;
+    if (x.teamB != y.teamB) return x.teamB < y.teamB;
+    if (x.idxA != y.idxA) return x.idxA < y.idxA;
+    return x.idxB < y.idxB;
 }
 
 // Insert swap suggestions into a store vector
 void insert_suggestion_sorted(vector<SwapSuggestion> &out_suggestions, const SwapSuggestion &sugg, int max_suggestions)
 {
+    // a full list only takes suggestions that beat its last one
+    if (out_suggestions.size() >= max_suggestions && (out_suggestions.empty() || !suggestion_before(sugg, out_suggestions.back())))
+    {
+        return;
+    }
+
     // intitalize insertion index
     int pos = 0;
 
-    // find correct point to insert and move forward while current delta is smaller
-    while (pos < out_suggestions.size() && out_suggestions[pos].delta <= sugg.delta)
+    // find correct point to insert and move forward while current suggestion goes first
+    while (pos < out_suggestions.size() && suggestion_before(out_suggestions[pos], sugg))
     {
         pos++;
     }
@@ -124,8 +571,307 @@ void insert_suggestion_sorted(vector<SwapSuggestion> &out_suggestions, const Swa
 
 }
 
-// generate suggestions to swap and improve balance between teams
-void generate_swap_suggestions(const vector<team> &teams, int max_suggestions, vector<SwapSuggestion> &out_suggestions)
+// everything generate_swap_suggestions reads per team, gathered once so a team pair only costs its swaps
+struct suggestion_scan
+{
+    const vector<team> *teams;
+    const constraint_store *cs;
+    balance_mode mode;
+    int k;
+    long long penalty;
+    unsigned required;
+    int categories;
+    long long category_units;
+    int slot_target;
+    unsigned long long slot_mask;
+    long long slot_penalty;
+    vector<unsigned> cover;            // roles each team covers
+    vector<unsigned> sole;             // roles only one member covers
+    vector<unsigned long long> common; // slots everybody / everybody but one is free in
+    vector<unsigned long long> near;
+    bool constrained;
+    team_masks masks;
+    bool by_skill;
+    vector<vector<int>> lanes;         // every member's skills, packed 8 lanes per member
+    vector<vector<long long>> key;     // every member's swap key
+    vector<member_order> order;        // and each team's members sorted by it
+    bool extremes;
+    team_heap highest;
+    team_heap lowest;
+    long long total_sum;
+};
+
+static void begin_suggestion_scan(suggestion_scan &scan, const vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    int teamCount = teams.size();
+    scan.teams = &teams;
+    scan.cs = cs;
+    scan.mode = mode;
+    scan.k = teamCount;
+    scan.penalty = role_penalty_units(teamCount);
+    scan.required = required_roles();
+    scan.categories = category_count();
+    scan.category_units = 2LL * teamCount * CATEGORY_PENALTY * SCORE_SCALE * SCORE_SCALE;
+    scan.slot_target = availability_target();
+    scan.slot_mask = availability_slot_mask();
+    scan.slot_penalty = availability_penalty_units(teamCount);
+
+    // coverage and sole-holder masks per team, so the roles after a swap are a few bit operations
+    scan.cover.resize(teamCount);
+    scan.sole.resize(teamCount);
+    for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+    {
+        scan.cover[teamIdx] = team_coverage(teams[teamIdx]);
+        scan.sole[teamIdx] = team_sole_roles(teams[teamIdx]);
+    }
+
+    // and the slots everybody / everybody but one is free in
+    if (scan.slot_target > 0)
+    {
+        scan.common.resize(teamCount);
+        scan.near.resize(teamCount);
+        for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+        {
+            scan.common[teamIdx] = team_common_slots(teams[teamIdx]);
+            scan.near[teamIdx] = slots_with_count(teams[teamIdx], teams[teamIdx].members.size() - 1);
+        }
+    }
+
+    // which conflicted students sit in each team, so a swap is checked in a few word operations
+    scan.constrained = has_constraints(cs);
+    if (scan.constrained)
+    {
+        build_team_masks(*cs, teams, scan.masks);
+    }
+
+    // per-skill mode reads every member's skills once
+    scan.by_skill = (mode == BALANCE_SKILLS);
+    if (scan.by_skill)
+    {
+        scan.lanes.resize(teamCount);
+        for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+        {
+            scan.lanes[teamIdx].resize(teams[teamIdx].members.size() * SKILL_LANES);
+            for (int m = 0; m < teams[teamIdx].members.size(); m++)
+            {
+                student_skill_lanes(teams[teamIdx].members[m], &scan.lanes[teamIdx][m * SKILL_LANES]);
+            }
+        }
+    }
+
+    // members sorted by swap key, so each member of one team finds its best partners in the other by binary search
+    scan.key.resize(teamCount);
+    scan.order.resize(teamCount);
+    for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+    {
+        scan.key[teamIdx].resize(teams[teamIdx].members.size());
+        for (int m = 0; m < teams[teamIdx].members.size(); m++)
+        {
+            scan.key[teamIdx][m] = swap_key(teams[teamIdx].members[m], scan.by_skill);
+        }
+        sort_members(teams[teamIdx], scan.by_skill, scan.order[teamIdx]);
+    }
+
+    // the extreme modes keep totals in a highest / lowest heap pair, so each team pair finds the
+    // extremes of the other teams in O(1)
+    scan.extremes = extreme_mode(mode);
+    scan.total_sum = 0;
+    if (scan.extremes)
+    {
+        heap_reset(scan.highest, teamCount, HEAP_HIGHEST_TOTAL);
+        heap_reset(scan.lowest, teamCount, HEAP_LOWEST_TOTAL);
+        for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+        {
+            heap_push(scan.highest, teams, teamIdx);
+            heap_push(scan.lowest, teams, teamIdx);
+            scan.total_sum += teams[teamIdx].total_score;
+        }
+    }
+}
+
+// try swapping every pair of members between teams a < b and add each to the suggestion list
+static void scan_team_pair(const suggestion_scan &scan, int teamAIndex, int teamBIndex, int max_suggestions, vector<SwapSuggestion> &out_suggestions)
+{
+    const vector<team> &teams = *scan.teams;
+    const team &A = teams[teamAIndex];
+    const team &B = teams[teamBIndex];
+    int sizeA = A.members.size();
+    int sizeB = B.members.size();
+    int teamCount = scan.k;
+
+    // skip empty teams
+    if (sizeA == 0 || sizeB == 0)
+    {
+        return;
+    }
+
+    long long gap[SKILL_LANES];
+    if (scan.by_skill)
+    {
+        lane_gaps(A, B, gap);
+    }
+
+    // only teams A and B can change what roles they are missing
+    int missing_before = missing_roles(scan.required, scan.cover[teamAIndex]) + missing_roles(scan.required, scan.cover[teamBIndex]);
+    // extremes of every team but these two, and the term before any swap
+    bool has_others = false;
+    long long others_high = 0;
+    long long others_low = 0;
+    long long extreme_before = 0;
+    if (scan.extremes)
+    {
+        int high = heap_best_excluding(scan.highest, teams, teamAIndex, teamBIndex);
+        int low = heap_best_excluding(scan.lowest, teams, teamAIndex, teamBIndex);
+        has_others = (high != -1);
+        long long hi = std::max(A.total_score, B.total_score);
+        long long lo = std::min(A.total_score, B.total_score);
+        if (has_others)
+        {
+            others_high = teams[high].total_score;
+            others_low = teams[low].total_score;
+            hi = std::max(hi, others_high);
+            lo = std::min(lo, others_low);
+        }
+        extreme_before = extreme_term(hi, lo, teamCount, scan.total_sum, scan.mode);
+    }
+
+    int short_before = 0;
+    if (scan.slot_target > 0)
+    {
+        short_before = slots_short(scan.common[teamAIndex], scan.slot_mask, scan.slot_target) + slots_short(scan.common[teamBIndex], scan.slot_mask, scan.slot_target);
+    }
+
+    // the most the roles, categories and slots can give back on any swap of this pair
+    long long extra_floor = -scan.penalty * missing_before - scan.slot_penalty * short_before;
+    if (scan.categories > 0)
+    {
+        extra_floor += scan.category_units * category_floor(A, B, scan.categories);
+    }
+
+    // the gap the swap keys close: the totals, or the summed skill gaps
+    long long key_gap = A.total_score - B.total_score;
+    long long gap_sq = 0;
+    if (scan.by_skill)
+    {
+        key_gap = 0;
+        for (int l = 0; l < SKILL_LANES; l++)
+        {
+            key_gap += gap[l];
+            gap_sq += gap[l] * gap[l];
+        }
+    }
+
+    // for each member of A, walk B from the member that would even the pair out. the spread part only grows
+    // (or its floor does, per skill) as the walk moves away, so once it can't make a full list the rest can't either
+    for (int memberAIndex = 0; memberAIndex < sizeA; memberAIndex++)
+    {
+        const student &sa = A.members[memberAIndex];
+        nearest_walk walk;
+        begin_walk(walk, scan.order[teamBIndex], 2 * scan.key[teamAIndex][memberAIndex] - key_gap);
+        long long distance;
+        int pos;
+
+        while ((pos = walk_next(walk, distance)) != -1)
+        {
+            int memberBIndex = scan.order[teamBIndex].member[pos];
+            const student &sb = B.members[memberBIndex];
+
+            // team A gains d and team B loses d, the sum of all totals stays the same
+            // so only the k * sum(t^2) part of the metric moves
+            long long spread_delta;
+            long long spread_low;
+            if (scan.by_skill)
+            {
+                spread_delta = 0;
+                spread_low = lane_spread_floor(distance, gap_sq, teamCount);
+            }
+            else
+            {
+                long long d = sb.student_score - sa.student_score;
+                spread_delta = (long long)teamCount * (2 * d * (A.total_score - B.total_score) + 2 * d * d);
+
+                if (scan.extremes)
+                {
+                    long long hi = std::max(A.total_score + d, B.total_score - d);
+                    long long lo = std::min(A.total_score + d, B.total_score - d);
+                    if (has_others)
+                    {
+                        hi = std::max(hi, others_high);
+                        lo = std::min(lo, others_low);
+                    }
+                    spread_delta += extreme_term(hi, lo, teamCount, scan.total_sum, scan.mode) - extreme_before;
+                }
+                spread_low = spread_delta;
+            }
+
+            if (out_suggestions.size() >= max_suggestions && spread_low + extra_floor > out_suggestions.back().delta)
+            {
+                break;
+            }
+
+            if (scan.constrained && !swap_allowed(scan.cs, scan.masks, teamAIndex, sa, teamBIndex, sb))
+            {
+                continue;
+            }
+
+            if (scan.by_skill)
+            {
+                spread_delta = 2LL * teamCount * SCORE_SCALE * SCORE_SCALE * lane_swap_delta(&scan.lanes[teamAIndex][memberAIndex * SKILL_LANES], &scan.lanes[teamBIndex][memberBIndex * SKILL_LANES], gap);
+            }
+
+            // category counts move by one on each side, read straight off the count vectors
+            if (scan.categories > 0)
+            {
+                spread_delta += scan.category_units * category_swap_delta(A, B, sa, sb, scan.categories);
+            }
+
+            // role coverage after the swap comes straight from the team masks
+            int missing_after = missing_roles(scan.required, coverage_after_swap(scan.cover[teamAIndex], scan.sole[teamAIndex], sa.roles, sb.roles)) +
+                                missing_roles(scan.required, coverage_after_swap(scan.cover[teamBIndex], scan.sole[teamBIndex], sb.roles, sa.roles));
+
+            // exact change in the metric (negative = improvement)
+            long long delta = spread_delta + scan.penalty * (missing_after - missing_before);
+
+            if (scan.slot_target > 0)
+            {
+                int short_after = slots_short(common_after_swap(scan.common[teamAIndex], scan.near[teamAIndex], sa.availability, sb.availability), scan.slot_mask, scan.slot_target) +
+                                  slots_short(common_after_swap(scan.common[teamBIndex], scan.near[teamBIndex], sb.availability, sa.availability), scan.slot_mask, scan.slot_target);
+                delta += scan.slot_penalty * (short_after - short_before);
+            }
+
+            // create suggestion
+            SwapSuggestion s;
+            s.teamA = teamAIndex;
+            s.idxA = memberAIndex;
+            s.teamB = teamBIndex;
+            s.idxB = memberBIndex;
+            s.delta = delta;
+
+            // only consider if delta is improvement (negative) OR top few even if positive
+            insert_suggestion_sorted(out_suggestions, s, max_suggestions);
+        }
+    }
+}
+
+// lowest the spread part of any swap between two teams can go when their radii add up to radius.
+// the two totals (or the summed skill gaps) differ by at most g = radius / k, and a swap that moves d
+// points costs k * (2dg + 2d^2) >= -k * g^2 / 2, or 2k * S^2 * d(g + d) >= -2k * S^2 * g^2 / 4 per lane
+static inline long long spread_floor(long long radius, long long k, bool by_skill)
+{
+    long long g = radius / k;
+    if (by_skill)
+    {
+        return -2 * k * SCORE_SCALE * SCORE_SCALE * (g * g / 4);
+    }
+    return -k * (g * g / 2);
+}
+
+// generate suggestions to swap and improve balance between teams.
+// a swap between two teams that are missing no roles and short of no slots can only gain on the spread
+// (and the categories), and how much is bounded by how far both teams sit from the mean. so the problem
+// teams are paired with everyone, the rest are paired from the most extreme down, and a pair whose bound
+// can't beat the worst suggestion in a full list is skipped. the list is the same as trying every pair
+void generate_swap_suggestions(const vector<team> &teams, int max_suggestions, vector<SwapSuggestion> &out_suggestions, const constraint_store *cs, balance_mode mode)
 {
     // empty suggestions list
     out_suggestions.clear();
@@ -134,171 +880,370 @@ void generate_swap_suggestions(const vector<team> &teams, int max_suggestions, v
     int teamCount = teams.size();
 
     // error handling
-    if (teamCount <= 1) 
+    if (teamCount <= 1 || max_suggestions <= 0)
     {
         return;
     }
-    
-    // compute the current balance metric
-    double base_metric = compute_balance_metric(teams);
 
-    // loop through all unique pairs of teams (A and B)
-    for (int teamAIndex = 0; teamAIndex < teamCount; teamAIndex++)
+    suggestion_scan scan;
+    begin_suggestion_scan(scan, teams, cs, mode);
+
+    // in the extreme modes a swap can only lower the extreme term if it moves the highest or lowest
+    // team, and not at all if three or more share that total (the third one stays where it is)
+    int at_high = 0;
+    int at_low = 0;
+    long long high = teams[0].total_score;
+    long long low = teams[0].total_score;
+    for (int teamIdx = 0; scan.extremes && teamIdx < teamCount; teamIdx++)
     {
-        for (int teamBIndex = teamAIndex + 1; teamBIndex < teamCount; teamBIndex++)
+        high = std::max(high, teams[teamIdx].total_score);
+        low = std::min(low, teams[teamIdx].total_score);
+    }
+    for (int teamIdx = 0; scan.extremes && teamIdx < teamCount; teamIdx++)
+    {
+        at_high += (teams[teamIdx].total_score == high);
+        at_low += (teams[teamIdx].total_score == low);
+    }
+
+    // mark the problem teams, and measure how far every other team sits from the mean:
+    // radius = |k * total - sum| (summed over the lanes in per-skill mode), and the same per categorical
+    // column, the value it is furthest off on
+    long long sum = 0;
+    long long lane_sum[SKILL_LANES] = {0};
+    for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+    {
+        sum += teams[teamIdx].total_score;
+        for (int l = 0; l < SKILL_LANES; l++)
         {
-            int sizeA = teams[teamAIndex].members.size();
-            int sizeB = teams[teamBIndex].members.size();
+            lane_sum[l] += teams[teamIdx].skill_totals[l];
+        }
+    }
 
-            // skip empty teams
-            if (sizeA == 0 || sizeB == 0) 
+    const vector<category_column> &categories = category_columns();
+    long long value_sum[MAX_CATEGORIES][MAX_CATEGORY_VALUES] = {{0}};
+    for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+    {
+        for (int c = 0; c < categories.size(); c++)
+        {
+            for (int v = 0; v < categories[c].values.size(); v++)
+            {
+                value_sum[c][v] += teams[teamIdx].category_counts[c][v];
+            }
+        }
+    }
+
+    vector<char> marked(teamCount, 0);
+    vector<long long> radius(teamCount, 0);
+    vector<long long> category_radius(teamCount, 0);
+    vector<int> ranked;
+    long long widest_category = 0;
+
+    for (int teamIdx = 0; teamIdx < teamCount; teamIdx++)
+    {
+        const team &T = teams[teamIdx];
+        if (T.members.empty())
+        {
+            continue;
+        }
+
+        marked[teamIdx] = missing_roles(scan.required, scan.cover[teamIdx]) > 0 ||
+                          (scan.slot_target > 0 && slots_short(scan.common[teamIdx], scan.slot_mask, scan.slot_target) > 0) ||
+                          (scan.extremes && ((T.total_score == high && at_high <= 2) || (T.total_score == low && at_low <= 2)));
+        if (marked[teamIdx])
+        {
+            continue;
+        }
+
+        if (scan.by_skill)
+        {
+            for (int l = 0; l < SKILL_LANES; l++)
+            {
+                radius[teamIdx] += std::llabs(teamCount * (long long)T.skill_totals[l] - lane_sum[l]);
+            }
+        }
+        else
+        {
+            radius[teamIdx] = std::llabs(teamCount * T.total_score - sum);
+        }
+
+        for (int c = 0; c < categories.size(); c++)
+        {
+            long long furthest = 0;
+            for (int v = 0; v < categories[c].values.size(); v++)
+            {
+                furthest = std::max(furthest, std::llabs(teamCount * (long long)T.category_counts[c][v] - value_sum[c][v]));
+            }
+            category_radius[teamIdx] += furthest;
+        }
+        widest_category = std::max(widest_category, category_radius[teamIdx]);
+
+        ranked.push_back(teamIdx);
+    }
+
+    // the problem teams try every other team (a pair of two of them only once)
+    for (int teamAIndex = 0; teamAIndex < teamCount; teamAIndex++)
+    {
+        if (!marked[teamAIndex])
+        {
+            continue;
+        }
+        for (int teamBIndex = 0; teamBIndex < teamCount; teamBIndex++)
+        {
+            if (teamBIndex == teamAIndex || (marked[teamBIndex] && teamBIndex < teamAIndex))
             {
                 continue;
             }
+            scan_team_pair(scan, std::min(teamAIndex, teamBIndex), std::max(teamAIndex, teamBIndex), max_suggestions, out_suggestions);
+        }
+    }
+
+    // the rest from the furthest off the mean down. a category step moves a count by at most the two
+    // teams' category radii over k, which costs at least -4 * penalty * S^2 per unit of radius
+    std::sort(ranked.begin(), ranked.end(), [&radius](int a, int b)
+              { return radius[a] != radius[b] ? radius[a] > radius[b] : a < b; });
+    long long category_floor = 4 * CATEGORY_PENALTY * SCORE_SCALE * SCORE_SCALE;
 
-            // try swapping every pair for members between A and B
-            for (int memberAIndex = 0; memberAIndex < sizeA; memberAIndex++)
+    for (int r = 0; r < ranked.size(); r++)
+    {
+        int a = ranked[r];
+        bool full = (out_suggestions.size() >= max_suggestions);
+
+        // every later team is at most as far off as this one, so nothing below can do better either
+        if (full && spread_floor(2 * radius[a], teamCount, scan.by_skill) - category_floor * 2 * widest_category > out_suggestions.back().delta)
+        {
+            break;
+        }
+
+        for (int s = r + 1; s < ranked.size(); s++)
+        {
+            int b = ranked[s];
+            if (out_suggestions.size() >= max_suggestions)
             {
-                for (int memberBIndex = 0; memberBIndex < sizeB; memberBIndex++)
+                long long lowest = spread_floor(radius[a] + radius[b], teamCount, scan.by_skill);
+                long long worst = out_suggestions.back().delta;
+                if (lowest - category_floor * (category_radius[a] + widest_category) > worst)
                 {
-                    // compute new totals and leader presence
-                    int oldA_total = teams[teamAIndex].total_score;
-                    int oldB_total = teams[teamBIndex].total_score;
+                    break;
+                }
+                if (lowest - category_floor * (category_radius[a] + category_radius[b]) > worst)
+                {
+                    continue;
+                }
+            }
+            scan_team_pair(scan, std::min(a, b), std::max(a, b), max_suggestions, out_suggestions);
+        }
+    }
+}
 
-                    int scoreA = teams[teamAIndex].members[memberAIndex].student_score;
-                    int scoreB = teams[teamBIndex].members[memberBIndex].student_score;
 
-                    int newA_total = oldA_total - scoreA + scoreB;
-                    int newB_total = oldB_total - scoreB + scoreA;
+// the best improving swap between two teams, found by walking b's sorted members from each member of a
+bool best_pair_swap(const vector<team> &teams, int a, int b, int budget, const constraint_store *cs, balance_mode mode, const total_extremes *extremes, SwapSuggestion &out)
+{
+    if (a == b || a < 0 || b < 0 || a >= teams.size() || b >= teams.size())
+    {
+        return false;
+    }
 
-                    // copy teams totals into a temporary vector of ints to compute metric
-                    vector<int> tempTotals;
+    const team &A = teams[a];
+    const team &B = teams[b];
+    pair_delta_context ctx;
+    begin_pair_delta(ctx, teams, a, b, mode, extremes);
 
-                    for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
-                    {
-                        if (teamIdx == teamAIndex) 
-                        {
-                            // replace team A's total
-                            tempTotals.push_back(newA_total);
-                        }
-
-                        // replace team B's total
-                        else if (teamIdx == teamBIndex) 
-                        {
-                            tempTotals.push_back(newB_total);
-                        }
-
-                        // keep other teams the same
-                        else 
-                        {
-                            tempTotals.push_back(teams[teamIdx].total_score);
-                        }
-                    }
+    // mask rows for just these two teams (row 0 = a, row 1 = b)
+    bool constrained = has_constraints(cs);
+    team_masks masks;
+    if (constrained)
+    {
+        masks.words = cs->words;
+        masks.bits.assign(2 * cs->words, 0);
+        for (int i = 0; i < A.members.size(); i++)
+        {
+            mask_toggle(cs, masks, 0, A.members[i]);
+        }
+        for (int j = 0; j < B.members.size(); j++)
+        {
+            mask_toggle(cs, masks, 1, B.members[j]);
+        }
+    }
 
-                    // compute leader missing count after swap
-                    int missing_after = 0;
+    // b's members by swap key, so each member of a starts at the partner that evens the pair out
+    bool by_skill = (mode == BALANCE_SKILLS);
+    member_order order_b;
+    sort_members(B, by_skill, order_b);
 
-                    for (int teamIdx = 0; teamIdx < teams.size(); teamIdx++)
-                    {
-                        bool hasLeader = teams[teamIdx].hasLeader;
-
-                        if (teamIdx == teamAIndex)
-                        {
-                            // after swap, check if team A has leader
-                            bool leaderFound = false;
-
-                            for (int memberIdx = 0; memberIdx < teams[teamAIndex].members.size(); memberIdx++)
-                            {
-                                if (memberIdx == memberAIndex)
-                                {
-                                    // check if swapped-in member from team B is a leader or not
-                                    if (teams[teamBIndex].members[memberBIndex].leadership >= LEADER_THRESHOLD) 
-                                    {
-                                        leaderFound = true;
-                                    }
-                                }
-
-                                // unchanged members remain in team A
-                                else
-                                {
-                                    if (teams[teamAIndex].members[memberIdx].leadership >= LEADER_THRESHOLD) 
-                                    {
-                                        leaderFound = true;
-                                    }
-                                }
-                            }
-                            // update team A's leader status
-                            hasLeader = leaderFound;
-                        }
-
-                        // evaluate team B after the swap
-                        else if (teamIdx == teamBIndex)
-                        {
-                            bool leaderFound = false;
-                            for (int memberIdx = 0; memberIdx < teams[teamBIndex].members.size(); memberIdx++)
-                            {
-                                if (memberIdx == memberBIndex)
-                                {
-                                    // check if incoming memebr from A is a leader
-                                    if (teams[teamAIndex].members[memberAIndex].leadership >= LEADER_THRESHOLD) 
-                                    {
-                                        leaderFound = true;
-                                    }
-                                }
-                                else
-                                {
-                                    if (teams[teamBIndex].members[memberIdx].leadership >= LEADER_THRESHOLD) 
-                                    {
-                                        leaderFound = true;
-                                    }
-                                }
-                            }
-                            // update team B's leadership status
-                            hasLeader = leaderFound;
-                        }
-
-                        // count missing leaders
-                        if (!hasLeader) 
-                        {
-                            missing_after++;
-                        }
-                    }
+    long long key_gap = ctx.total_gap;
+    long long gap_sq = 0;
+    if (by_skill)
+    {
+        key_gap = 0;
+        for (int l = 0; l < SKILL_LANES; l++)
+        {
+            key_gap += ctx.gap[l];
+            gap_sq += ctx.gap[l] * ctx.gap[l];
+        }
+    }
+    long long extra_floor = pair_extra_floor(ctx);
+
+    long long best_delta = 0;
+    int best_i = -1;
+    int best_j = -1;
+    int evaluated = 0;
 
-                    // compute variance for tempTotals
-                    double mean_value = 0.0;
+    // newest members of a are tried first, that's where an insertion left the imbalance.
+    // the walk over b stops once the spread part (or its floor) plus the best the roles, categories and
+    // slots can do is no better than the best swap so far
+    for (int i = A.members.size() - 1; i >= 0 && evaluated < budget; i--)
+    {
+        const student &sa = A.members[i];
+        nearest_walk walk;
+        begin_walk(walk, order_b, 2 * swap_key(sa, by_skill) - key_gap);
+        long long distance;
+        int pos;
 
-                    for (int tIdx = 0; tIdx < tempTotals.size(); tIdx++) mean_value += tempTotals[tIdx];
-                    mean_value = mean_value / tempTotals.size();
+        while (evaluated < budget && (pos = walk_next(walk, distance)) != -1)
+        {
+            int j = order_b.member[pos];
+            const student &sb = B.members[j];
 
-                    double accum = 0.0;
+            long long spread_low = by_skill ? lane_spread_floor(distance, gap_sq, ctx.k) : pair_spread_delta(ctx, sb.student_score - sa.student_score);
+            if (spread_low + extra_floor >= best_delta)
+            {
+                break;
+            }
+            evaluated++;
 
-                    for (int tIdx = 0; tIdx < tempTotals.size(); tIdx++)
+            if (constrained)
+            {
+                int pin_a = pinned_team_of(cs, sa);
+                int pin_b = pinned_team_of(cs, sb);
+                if ((pin_a != -1 && pin_a != b) || (pin_b != -1 && pin_b != a) || !fits_mask(cs, masks, 1, sa, &sb) || !fits_mask(cs, masks, 0, sb, &sa))
+                {
+                    continue;
+                }
+            }
+
+            // same closed form as generate_swap_suggestions
+            long long delta = pair_swap_delta(ctx, sa, sb);
+
+            if (delta < best_delta)
+            {
+                best_delta = delta;
+                best_i = i;
+                best_j = j;
+            }
+        }
+    }
+
+    if (best_i == -1)
+    {
+        return false;
+    }
+
+    out.teamA = a;
+    out.idxA = best_i;
+    out.teamB = b;
+    out.idxB = best_j;
+    out.delta = best_delta;
+    return true;
+}
+
+// try swaps between two teams and apply the best improving one (a short local repair)
+bool improve_team_pair(vector<team> &teams, int a, int b, int budget, const constraint_store *cs, balance_mode mode, const total_extremes *extremes)
+{
+    SwapSuggestion best;
+    if (!best_pair_swap(teams, a, b, budget, cs, mode, extremes, best))
+    {
+        return false;
+    }
+
+    swap_members(teams[a], best.idxA, teams[b], best.idxB);
+    return true;
+}
+// for every value of every categorical column, pair the teams holding the most of it with the teams
+// holding the least and let improve_team_pair (which sees the category term) swap between them
+void balance_categories(vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    const vector<category_column> &categories = category_columns();
+    int k = teams.size();
+    vector<int> order(k);
+
+    for (int pass = 0; pass < CATEGORY_PASSES; pass++)
+    {
+        bool improved = false;
+
+        for (int c = 0; c < categories.size(); c++)
+        {
+            for (int v = 0; v < categories[c].values.size(); v++)
+            {
+                for (int t = 0; t < k; t++)
+                {
+                    order[t] = t;
+                }
+                std::sort(order.begin(), order.end(), [&teams, c, v](int a, int b)
+                          { return teams[a].category_counts[c][v] > teams[b].category_counts[c][v]; });
+
+                // most with least, then second most with second least, until the gap is under 2
+                for (int i = 0; i < k / 2; i++)
+                {
+                    int a = order[i];
+                    int b = order[k - 1 - i];
+                    if (teams[a].category_counts[c][v] - teams[b].category_counts[c][v] < 2)
                     {
-                        double diff = tempTotals[tIdx] - mean_value;
-                        accum += diff * diff;
+                        break;
                     }
+                    int budget = teams[a].members.size() * teams[b].members.size();
+                    if (improve_team_pair(teams, a, b, budget, cs, mode))
+                    {
+                        improved = true;
+                    }
+                }
+            }
+        }
 
-                    // new variance is stored in var_after
-                    double var_after = accum / tempTotals.size();
+        if (!improved)
+        {
+            break;
+        }
+    }
+}
 
-                    // same penalty contant
-                    const double LEADER_PENALTY = 1000.0;
-                    double metric_after = var_after + LEADER_PENALTY * missing_after;
+// every team short of common slots tries swaps with a handful of teams spread around the list
+void repair_availability(vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    int target = availability_target();
+    int k = teams.size();
+    if (target == 0 || k < 2)
+    {
+        return;
+    }
 
-                    double delta = metric_after - base_metric;
+    unsigned long long slot_mask = availability_slot_mask();
+    int partners = std::min(AVAILABILITY_PARTNERS, k - 1);
 
-                    // create suggestion
-                    SwapSuggestion s;
-                    s.teamA = teamAIndex;
-                    s.idxA = memberAIndex;
-                    s.teamB = teamBIndex;
-                    s.idxB = memberBIndex;
-                    s.delta = delta;
+    for (int pass = 0; pass < CATEGORY_PASSES; pass++)
+    {
+        bool improved = false;
 
-                    // only consider if delta is improvement (negative) OR top few even if positive
-                    insert_suggestion_sorted(out_suggestions, s, max_suggestions);
+        for (int a = 0; a < k; a++)
+        {
+            for (int p = 1; p <= partners && slots_short(team_common_slots(teams[a]), slot_mask, target) > 0; p++)
+            {
+                int b = (a + (long long)p * k / (partners + 1)) % k;
+                if (b == a)
+                {
+                    continue;
+                }
+                int budget = teams[a].members.size() * teams[b].members.size();
+                if (improve_team_pair(teams, a, b, budget, cs, mode))
+                {
+                    improved = true;
                 }
             }
         }
+
+        if (!improved)
+        {
+            break;
+        }
     }
 }
@@ -1,6 +1,129 @@
 #pragma once
 #include "structs.h"
+#include "constraints.h"
 #include <vector>
 
-// Generate up to "max_suggestions" suggestions (best improvements).
-void generate_swap_suggestions(const std::vector<team> &teams, int max_suggestions, std::vector<SwapSuggestion> &out_suggestions);
+// What the metric balances: the scalar team totals, or every skill on its own
+// (the summed per-skill variance, so one team can't hoard the backend experts while the totals match).
+// The last two put the worst team first: the gap between the highest and lowest total, or the furthest
+// any total sits from the mean (variance is still added so swaps away from the extremes count too).
+enum balance_mode
+{
+    BALANCE_TOTAL,
+    BALANCE_SKILLS,
+    BALANCE_RANGE,
+    BALANCE_MAX_DEVIATION
+};
+
+// true for the modes that look at the extreme teams
+inline bool extreme_mode(balance_mode mode)
+{
+    return mode == BALANCE_RANGE || mode == BALANCE_MAX_DEVIATION;
+}
+
+struct team_heap; // incremental.h
+
+// Where the extreme modes read the highest and lowest totals from: a HEAP_HIGHEST_TOTAL and a
+// HEAP_LOWEST_TOTAL heap over every team, and the sum of every total. Without one, begin_pair_delta
+// scans all k teams.
+struct total_extremes
+{
+    const team_heap *highest;
+    const team_heap *lowest;
+    long long sum;
+};
+
+// Where compute_balance_metric stops counting, with headroom left so adding a metric or two can't overflow.
+const long long METRIC_SATURATION = (long long)(~0ULL >> 1) / 4;
+
+// Exact integer balance metric: k^2 * variance of team totals (fixed point) plus a penalty per missing role,
+// plus CATEGORY_PENALTY times the spread of every categorical value over the teams (see categories.h),
+// plus AVAILABILITY_PENALTY per common meeting slot a team is short of (see availability.h).
+// In BALANCE_SKILLS mode the variance is summed over the six skill totals instead. BALANCE_RANGE adds
+// (k * (highest - lowest))^2 and BALANCE_MAX_DEVIATION adds (k * the biggest |total - mean|)^2.
+// The sum stops at METRIC_SATURATION (swap deltas are exact regardless, they only see two teams).
+long long compute_balance_metric(const std::vector<team> &teams, balance_mode mode = BALANCE_TOTAL);
+
+// Spread of the team totals on its own (k^2 * variance, no penalties), in metric units.
+long long team_spread_metric(const std::vector<team> &teams);
+
+// Summed per-skill spread on its own (no role penalty), in metric units.
+long long skill_spread_metric(const std::vector<team> &teams);
+
+// The category term of the metric on its own, in metric units (0 without categorical columns).
+long long category_spread_metric(const std::vector<team> &teams);
+
+// Common slots all teams together are short of the availability target (0 without an availability column).
+int total_slots_short(const std::vector<team> &teams);
+
+// Convert a metric or a delta back into variance of whole points (for display only).
+double metric_to_variance(long long metric, int team_count);
+
+// Everything the swap delta between two fixed teams needs, gathered once per pair so each swap is O(lanes).
+struct pair_delta_context
+{
+    long long k;
+    long long total_gap;       // A.total_score - B.total_score
+    long long gap[SKILL_LANES]; // per-skill A - B (BALANCE_SKILLS only)
+    unsigned required;
+    unsigned cover_a, cover_b; // roles each team covers
+    unsigned sole_a, sole_b;   // roles only one member covers
+    int missing_before;
+    long long penalty;         // metric units per missing role
+    balance_mode mode;
+    const team *team_a;        // category counts are read straight from the two teams
+    const team *team_b;
+    int categories;            // active categorical columns
+    long long category_units;  // metric units per step of the category delta
+    int slot_target;           // common slots a team should have (0 = availability is off)
+    unsigned long long slot_mask;
+    unsigned long long common_a, common_b; // slots every member is free in
+    unsigned long long near_a, near_b;     // slots all but one member is free in
+    int short_before;
+    long long slot_penalty;    // metric units per slot short
+    long long total_a, total_b;
+    bool has_others;           // there are teams besides a and b
+    long long others_high;     // highest and lowest total among the other teams
+    long long others_low;
+    long long total_sum;
+    long long extreme_before;  // the extreme term before the swap (extreme modes only)
+};
+
+// Fill ctx for swaps between teams a and b. The extreme modes read the other teams' extremes from
+// extremes in O(1) when it's given, and scan every team when it isn't.
+void begin_pair_delta(pair_delta_context &ctx, const std::vector<team> &teams, int a, int b, balance_mode mode = BALANCE_TOTAL, const total_extremes *extremes = nullptr);
+
+// Exact change in compute_balance_metric if sa (in a) and sb (in b) swapped.
+long long pair_swap_delta(const pair_delta_context &ctx, const student &sa, const student &sb);
+
+// Same for a single swap, member ia of team a with member ib of team b.
+long long swap_metric_delta(const std::vector<team> &teams, int a, int ia, int b, int ib, balance_mode mode = BALANCE_TOTAL);
+
+// Look at up to budget member swaps between teams a and b and set out to the one that lowers the balance
+// metric the most. Returns false if none of them lowers it (out is left alone). Swaps that break a constraint
+// in cs are skipped. b's members are sorted by score (summed skills per skill) and each member of a walks out
+// from the partner that evens the pair, stopping once nothing further out can beat the best swap so far.
+// extremes is passed on to begin_pair_delta (it stays valid, a swap doesn't change the other teams or the sum).
+bool best_pair_swap(const std::vector<team> &teams, int a, int b, int budget, const constraint_store *cs, balance_mode mode, const total_extremes *extremes, SwapSuggestion &out);
+
+// best_pair_swap, then make the swap. Returns true if a swap was made.
+bool improve_team_pair(std::vector<team> &teams, int a, int b, int budget, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL, const total_extremes *extremes = nullptr);
+
+// Generate up to "max_suggestions" suggestions (best improvements), leaving out swaps cs doesn't allow.
+// Teams missing a role, short of slots or holding an extreme total are paired with every team, the rest
+// only while a bound on how far they sit from the mean says a pair could still make the list. The list is
+// the same as trying every pair (ties go to the lower team, then member, indices).
+void generate_swap_suggestions(const std::vector<team> &teams, int max_suggestions, std::vector<SwapSuggestion> &out_suggestions, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+// passes of balance_categories over every categorical value
+const int CATEGORY_PASSES = 4;
+
+// Even out the categorical columns: for each value the teams holding the most of it are paired with
+// the teams holding the least, and the best metric-lowering swap between each pair is applied.
+void balance_categories(std::vector<team> &teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+// teams repair_availability tries for each team short of common slots
+const int AVAILABILITY_PARTNERS = 8;
+
+// Give teams short of common meeting slots a few tries at a metric-lowering swap with other teams.
+void repair_availability(std::vector<team> &teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
@@ -0,0 +1,697 @@
+// including relevant libraries
+#include "partition.h"
+#include "allocator.h"
+#include "optimizer.h"
+#include "splashkit.h"
+#include <algorithm>
+#include <queue>
+#include <random>
+
+using std::to_string;
+using std::vector;
+
+// one level of the hierarchy, level 0 is one vertex per student
+struct graph_level
+{
+    preference_graph g;
+    vector<int> count;       // students in each vertex
+    vector<long long> score; // their summed score
+    vector<int> roles;       // role counts, MAX_ROLES per vertex
+    vector<int> pin;         // team the vertex has to be in, -1 = free
+    vector<int> cmap;        // vertex of the next coarser level
+    int max_count;           // biggest vertex
+};
+
+// the partition being refined, kept for whichever level is current
+struct partition_state
+{
+    int k;
+    vector<int> part;        // team of every vertex
+    vector<int> size;        // students per team
+    vector<long long> total; // summed score per team
+    vector<int> roles;       // role counts, MAX_ROLES per team
+};
+
+/**
+ * level 0: the preference graph plus an edge for every apart rule
+ */
+static void base_level(const vector<student> &students, const preference_graph &g, int k, const constraint_store *cs, graph_level &L)
+{
+    int n = students.size();
+
+    // apart rules live in per-slot bitsets, turn them back into student pairs
+    vector<weighted_edge> apart;
+    if (has_constraints(cs) && cs->words > 0)
+    {
+        vector<int> student_of_slot(cs->words * 64, -1);
+        for (int i = 0; i < n && i < cs->slot.size(); i++)
+        {
+            if (cs->slot[i] != -1)
+            {
+                student_of_slot[cs->slot[i]] = i;
+            }
+        }
+
+        for (int s = 0; s < student_of_slot.size(); s++)
+        {
+            if (student_of_slot[s] == -1)
+            {
+                continue;
+            }
+            for (int t = s + 1; t < student_of_slot.size(); t++)
+            {
+                if (student_of_slot[t] != -1 && (cs->conflicts[(size_t)s * cs->words + t / 64] >> (t % 64) & 1ULL))
+                {
+                    apart.push_back({student_of_slot[s], student_of_slot[t], APART_EDGE_WEIGHT});
+                }
+            }
+        }
+    }
+
+    if (apart.empty())
+    {
+        L.g = g;
+    }
+    else
+    {
+        for (int u = 0; u < g.n; u++)
+        {
+            for (int e = g.start[u]; e < g.start[u + 1]; e++)
+            {
+                if (g.adj[e] > u)
+                {
+                    apart.push_back({u, g.adj[e], g.weight[e]});
+                }
+            }
+        }
+        build_graph_rows(n, apart, L.g);
+    }
+
+    L.count.assign(n, 1);
+    L.score.resize(n);
+    L.roles.assign((size_t)n * MAX_ROLES, 0);
+    L.pin.assign(n, -1);
+    L.max_count = 1;
+    for (int i = 0; i < n; i++)
+    {
+        L.score[i] = students[i].student_score;
+        for (int r = 0; r < MAX_ROLES; r++)
+        {
+            L.roles[(size_t)i * MAX_ROLES + r] = (students[i].roles >> r) & 1u;
+        }
+
+        int pin = pinned_team_of(cs, students[i]);
+        L.pin[i] = (pin >= 0 && pin < k) ? pin : -1;
+    }
+}
+
+/**
+ * heavy-edge matching: every vertex (in random order) pairs with the unmatched neighbour it wants most,
+ * as long as the pair stays under max_count students. false if the graph barely shrank
+ */
+static bool coarsen(graph_level &fine, graph_level &coarse, int max_count, std::mt19937 &rng)
+{
+    const preference_graph &g = fine.g;
+    int n = g.n;
+
+    vector<int> order(n);
+    for (int v = 0; v < n; v++)
+    {
+        order[v] = v;
+    }
+    std::shuffle(order.begin(), order.end(), rng);
+
+    vector<int> match(n, -1);
+    for (int i = 0; i < n; i++)
+    {
+        int v = order[i];
+        if (match[v] != -1)
+        {
+            continue;
+        }
+
+        int best = -1;
+        int best_weight = 0;
+        for (int e = g.start[v]; e < g.start[v + 1]; e++)
+        {
+            int u = g.adj[e];
+            if (match[u] != -1 || g.weight[e] <= best_weight || fine.count[u] + fine.count[v] > max_count)
+            {
+                continue;
+            }
+            if (fine.pin[u] != -1 && fine.pin[v] != -1 && fine.pin[u] != fine.pin[v])
+            {
+                continue;
+            }
+            best = u;
+            best_weight = g.weight[e];
+        }
+
+        match[v] = (best == -1) ? v : best;
+        if (best != -1)
+        {
+            match[best] = v;
+        }
+    }
+
+    // number the coarse vertices, a pair shares one
+    fine.cmap.assign(n, -1);
+    vector<int> first;
+    for (int v = 0; v < n; v++)
+    {
+        if (fine.cmap[v] == -1)
+        {
+            fine.cmap[v] = first.size();
+            fine.cmap[match[v]] = first.size();
+            first.push_back(v);
+        }
+    }
+
+    int nc = first.size();
+    if (nc > n * 0.95)
+    {
+        return false;
+    }
+
+    coarse.count.assign(nc, 0);
+    coarse.score.assign(nc, 0);
+    coarse.roles.assign((size_t)nc * MAX_ROLES, 0);
+    coarse.pin.assign(nc, -1);
+    coarse.max_count = 1;
+    for (int v = 0; v < n; v++)
+    {
+        int c = fine.cmap[v];
+        coarse.count[c] += fine.count[v];
+        coarse.score[c] += fine.score[v];
+        coarse.pin[c] = std::max(coarse.pin[c], fine.pin[v]);
+        for (int r = 0; r < MAX_ROLES; r++)
+        {
+            coarse.roles[(size_t)c * MAX_ROLES + r] += fine.roles[(size_t)v * MAX_ROLES + r];
+        }
+        coarse.max_count = std::max(coarse.max_count, coarse.count[c]);
+    }
+
+    // contract the edges row by row, the marker says where a coarse neighbour already is in this row
+    preference_graph &cg = coarse.g;
+    cg.n = nc;
+    cg.start.assign(nc + 1, 0);
+    cg.adj.clear();
+    cg.weight.clear();
+    vector<int> marker(nc, -1);
+    for (int c = 0; c < nc; c++)
+    {
+        int row_begin = cg.adj.size();
+        int members[2] = {first[c], match[first[c]]};
+        int member_count = (members[0] == members[1]) ? 1 : 2;
+
+        for (int m = 0; m < member_count; m++)
+        {
+            int v = members[m];
+            for (int e = g.start[v]; e < g.start[v + 1]; e++)
+            {
+                int cu = fine.cmap[g.adj[e]];
+                if (cu == c)
+                {
+                    continue;
+                }
+                if (marker[cu] >= row_begin)
+                {
+                    cg.weight[marker[cu]] += g.weight[e];
+                }
+                else
+                {
+                    marker[cu] = cg.adj.size();
+                    cg.adj.push_back(cu);
+                    cg.weight.push_back(g.weight[e]);
+                }
+            }
+        }
+
+        for (int e = row_begin; e < cg.adj.size(); e++)
+        {
+            marker[cg.adj[e]] = -1;
+        }
+        cg.start[c + 1] = cg.adj.size();
+    }
+
+    return true;
+}
+
+/**
+ * put vertex v in team t and update the team's stats
+ */
+static void place_vertex(const graph_level &L, partition_state &ps, int v, int t, int sign)
+{
+    ps.size[t] += sign * L.count[v];
+    ps.total[t] += sign * L.score[v];
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        ps.roles[(size_t)t * MAX_ROLES + r] += sign * L.roles[(size_t)v * MAX_ROLES + r];
+    }
+}
+
+/**
+ * true if v is the last holder of some role in its team
+ */
+static bool holds_last_role(const graph_level &L, const partition_state &ps, int v)
+{
+    int t = ps.part[v];
+    for (int r = 0; r < MAX_ROLES; r++)
+    {
+        int mine = L.roles[(size_t)v * MAX_ROLES + r];
+        if (mine > 0 && ps.roles[(size_t)t * MAX_ROLES + r] == mine)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// per-team edge weight of one vertex, only the touched teams are cleared between vertices
+struct team_links
+{
+    vector<long long> conn;
+    vector<char> seen;
+    vector<int> touched;
+};
+
+/**
+ * add v's edge weight to every team it has a neighbour in
+ */
+static void team_connections(const graph_level &L, const partition_state &ps, int v, team_links &links)
+{
+    for (int i = 0; i < links.touched.size(); i++)
+    {
+        links.conn[links.touched[i]] = 0;
+        links.seen[links.touched[i]] = 0;
+    }
+    links.touched.clear();
+    links.conn.resize(ps.k, 0);
+    links.seen.resize(ps.k, 0);
+
+    for (int e = L.g.start[v]; e < L.g.start[v + 1]; e++)
+    {
+        int t = ps.part[L.g.adj[e]];
+        if (t == -1)
+        {
+            continue;
+        }
+        if (!links.seen[t])
+        {
+            links.seen[t] = 1;
+            links.touched.push_back(t);
+        }
+        links.conn[t] += L.g.weight[e];
+    }
+}
+
+/**
+ * greedy partition of the coarsest graph: pinned vertices first, then biggest scores first into the
+ * team they're most connected to, unless that team is more than tol ahead of the lowest total
+ */
+static void initial_partition(const graph_level &L, partition_state &ps, int cap_size, long long tol)
+{
+    int n = L.g.n;
+    int k = ps.k;
+    ps.part.assign(n, -1);
+    ps.size.assign(k, 0);
+    ps.total.assign(k, 0);
+    ps.roles.assign((size_t)k * MAX_ROLES, 0);
+
+    for (int v = 0; v < n; v++)
+    {
+        if (L.pin[v] != -1)
+        {
+            ps.part[v] = L.pin[v];
+            place_vertex(L, ps, v, L.pin[v], 1);
+        }
+    }
+
+    vector<int> order;
+    for (int v = 0; v < n; v++)
+    {
+        if (ps.part[v] == -1)
+        {
+            order.push_back(v);
+        }
+    }
+    std::stable_sort(order.begin(), order.end(), [&L](int a, int b)
+                     { return L.score[a] > L.score[b]; });
+
+    // lowest total first, entries go stale when a team changes and are skipped
+    typedef std::pair<long long, int> entry;
+    std::priority_queue<entry, vector<entry>, std::greater<entry>> lowest;
+    for (int t = 0; t < k; t++)
+    {
+        lowest.push(entry(ps.total[t], t));
+    }
+
+    team_links links;
+    for (int i = 0; i < order.size(); i++)
+    {
+        int v = order[i];
+
+        while (!lowest.empty() && (lowest.top().first != ps.total[lowest.top().second] || ps.size[lowest.top().second] >= cap_size))
+        {
+            lowest.pop();
+        }
+
+        int low = lowest.empty() ? -1 : lowest.top().second;
+        int target = -1;
+
+        team_connections(L, ps, v, links);
+        for (int j = 0; j < links.touched.size(); j++)
+        {
+            int t = links.touched[j];
+            long long c = links.conn[t];
+            if (c <= 0 || ps.size[t] + L.count[v] > cap_size || (low != -1 && ps.total[t] > ps.total[low] + tol))
+            {
+                continue;
+            }
+            if (target == -1 || c > links.conn[target] || (c == links.conn[target] && ps.total[t] < ps.total[target]))
+            {
+                target = t;
+            }
+        }
+
+        if (target == -1)
+        {
+            target = low;
+        }
+
+        // every team is at the cap (big coarse vertices), the smallest one takes it
+        if (target == -1)
+        {
+            target = std::min_element(ps.size.begin(), ps.size.end()) - ps.size.begin();
+        }
+
+        ps.part[v] = target;
+        place_vertex(L, ps, v, target, 1);
+        lowest.push(entry(ps.total[target], target));
+    }
+}
+
+/**
+ * greedy boundary refinement (the k-way refinement METIS uses): each free vertex moves to the team it is
+ * most connected to if that gains weight and both teams stay inside the size and total bands
+ */
+static void refine(const graph_level &L, partition_state &ps, int lo, int hi, long long mean, long long tol, std::mt19937 &rng)
+{
+    int n = L.g.n;
+    vector<int> order(n);
+    for (int v = 0; v < n; v++)
+    {
+        order[v] = v;
+    }
+
+    team_links links;
+
+    for (int pass = 0; pass < REFINE_PASSES; pass++)
+    {
+        std::shuffle(order.begin(), order.end(), rng);
+        int moves = 0;
+
+        for (int i = 0; i < n; i++)
+        {
+            int v = order[i];
+            int own = ps.part[v];
+            if (L.pin[v] != -1 || L.g.start[v] == L.g.start[v + 1])
+            {
+                continue;
+            }
+
+            team_connections(L, ps, v, links);
+            long long own_conn = links.conn[own];
+
+            int best = -1;
+            long long best_gain = 0;
+            for (int j = 0; j < links.touched.size(); j++)
+            {
+                int t = links.touched[j];
+                long long gain = links.conn[t] - own_conn;
+                if (t == own || gain <= best_gain)
+                {
+                    continue;
+                }
+                if (ps.size[t] + L.count[v] > hi || ps.size[own] - L.count[v] < lo)
+                {
+                    continue;
+                }
+                if (ps.total[t] + L.score[v] > mean + tol || ps.total[own] - L.score[v] < mean - tol)
+                {
+                    continue;
+                }
+                best = t;
+                best_gain = gain;
+            }
+
+            if (best == -1 || holds_last_role(L, ps, v))
+            {
+                continue;
+            }
+
+            place_vertex(L, ps, v, own, -1);
+            place_vertex(L, ps, v, best, 1);
+            ps.part[v] = best;
+            moves++;
+        }
+
+        if (moves == 0)
+        {
+            break;
+        }
+    }
+}
+
+/**
+ * true if moving a student worth score from donor to receiver leaves both totals inside mean +- tol
+ * (scores are never negative, so the donor can only fall and the receiver only rise)
+ */
+static bool keeps_total_band(const partition_state &ps, int donor, int receiver, long long score, long long mean, long long tol)
+{
+    return ps.total[donor] - score >= mean - tol && ps.total[receiver] + score <= mean + tol;
+}
+
+/**
+ * refinement leaves sizes up to one outside [lo, hi]; move the cheapest students until they are inside.
+ * a move that would push either team's total out of mean +- tol is only made when no other member can go
+ */
+static void balance_sizes(const graph_level &L, partition_state &ps, int lo, int hi, long long mean, long long tol)
+{
+    int n = L.g.n;
+    int k = ps.k;
+    vector<vector<int>> members(k);
+    for (int v = 0; v < n; v++)
+    {
+        members[ps.part[v]].push_back(v);
+    }
+
+    team_links links;
+    int over = 0;
+    int under = 0;
+    int spare_room = 0;
+    int spare_people = 0;
+
+    while (true)
+    {
+        // first team still too big / too small, and teams that can give or take one without leaving the band
+        while (over < k && ps.size[over] <= hi)
+        {
+            over++;
+        }
+        while (under < k && ps.size[under] >= lo)
+        {
+            under++;
+        }
+        if (over == k && under == k)
+        {
+            return;
+        }
+        while (spare_room < k && ps.size[spare_room] >= hi)
+        {
+            spare_room++;
+        }
+        while (spare_people < k && ps.size[spare_people] <= lo)
+        {
+            spare_people++;
+        }
+
+        int donor = (over < k) ? over : spare_people;
+        int receiver = (under < k) ? under : spare_room;
+        if (donor >= k || receiver >= k || donor == receiver)
+        {
+            return;
+        }
+
+        // the member whose move loses the least preference weight, keeping both totals in the band if anyone can
+        vector<int> &from = members[donor];
+        int best = -1;
+        long long best_gain = 0;
+        for (int band = 1; band >= 0 && best == -1; band--)
+        {
+            for (int m = 0; m < from.size(); m++)
+            {
+                int v = from[m];
+                if (L.pin[v] != -1 || holds_last_role(L, ps, v))
+                {
+                    continue;
+                }
+                if (band && !keeps_total_band(ps, donor, receiver, L.score[v], mean, tol))
+                {
+                    continue;
+                }
+
+                team_connections(L, ps, v, links);
+                long long gain = links.conn[receiver] - links.conn[donor];
+                if (best == -1 || gain > best_gain)
+                {
+                    best = m;
+                    best_gain = gain;
+                }
+            }
+        }
+
+        // nobody can leave without breaking a pin or a role, take anyone unpinned
+        if (best == -1)
+        {
+            for (int m = 0; m < from.size() && best == -1; m++)
+            {
+                if (L.pin[from[m]] == -1)
+                {
+                    best = m;
+                }
+            }
+        }
+        if (best == -1)
+        {
+            return;
+        }
+
+        int v = from[best];
+        from[best] = from.back();
+        from.pop_back();
+        members[receiver].push_back(v);
+        place_vertex(L, ps, v, donor, -1);
+        place_vertex(L, ps, v, receiver, 1);
+        ps.part[v] = receiver;
+
+        // a team the scans passed can be back in play after the move
+        over = std::min(over, donor);
+        under = std::min(under, receiver);
+        spare_room = std::min(spare_room, donor);
+        spare_people = std::min(spare_people, receiver);
+    }
+}
+
+/**
+ * multilevel allocation (see partition.h)
+ */
+vector<team> allocate_teams_partitioned(const vector<student> &students, const preference_graph &g, int num_teams, const constraint_store *cs)
+{
+    vector<team> teams;
+    int n = students.size();
+    if (num_teams <= 0 || n == 0 || g.n != n)
+    {
+        write_line("Partitioning needs students, a preference graph for them and at least one team.");
+        return teams;
+    }
+
+    int k = num_teams;
+    int lo = n / k;
+    int hi = (n + k - 1) / k;
+    std::mt19937 rng(1);
+
+    // coarsen until there are only a few vertices per team, or matching stops shrinking the graph
+    vector<graph_level> levels(1);
+    base_level(students, g, k, cs, levels[0]);
+    int max_count = hi;
+    while (levels.back().g.n > k * COARSEN_VERTICES_PER_TEAM)
+    {
+        graph_level coarse;
+        if (!coarsen(levels.back(), coarse, max_count, rng))
+        {
+            break;
+        }
+        levels.push_back(std::move(coarse));
+    }
+
+    long long sum = 0;
+    for (int i = 0; i < n; i++)
+    {
+        sum += students[i].student_score;
+    }
+    long long mean = sum / k;
+    long long tol = (long long)(mean * PARTITION_TOTAL_TOLERANCE);
+
+    partition_state ps;
+    ps.k = k;
+    const graph_level &coarsest = levels.back();
+    initial_partition(coarsest, ps, hi + coarsest.max_count - 1, tol);
+
+    // refine, then hand the teams down a level, up to the students themselves
+    for (int l = levels.size() - 1; l >= 0; l--)
+    {
+        const graph_level &L = levels[l];
+        int slack = std::max(1, L.max_count);
+        long long score_slack = 0;
+        for (int v = 0; v < L.g.n; v++)
+        {
+            score_slack = std::max(score_slack, L.score[v]);
+        }
+        refine(L, ps, lo - slack, hi + slack, mean, tol + score_slack, rng);
+
+        if (l > 0)
+        {
+            const graph_level &finer = levels[l - 1];
+            vector<int> part(finer.g.n);
+            for (int v = 0; v < finer.g.n; v++)
+            {
+                part[v] = ps.part[finer.cmap[v]];
+            }
+            ps.part.swap(part);
+        }
+    }
+
+    balance_sizes(levels[0], ps, lo, hi, mean, tol);
+
+    teams.resize(k);
+    for (int t = 0; t < k; t++)
+    {
+        teams[t].members.reserve(hi);
+        teams[t].size = 0;
+        teams[t].total_score = 0;
+        teams[t].hasLeader = false;
+        teams[t].leaders = 0;
+        teams[t].id = t + 1;
+    }
+    for (int i = 0; i < n; i++)
+    {
+        add_member_to_team(teams[ps.part[i]], students[i]);
+    }
+
+    ensure_leader_present(teams, false, cs);
+
+    int violations = count_constraint_violations(cs, teams);
+    if (violations > 0)
+    {
+        write_line("Could not honour " + to_string(violations) + " constraints.");
+    }
+
+    // pins, roles and the size fix can each force a total out of the band, say so rather than hide it
+    int outside = 0;
+    for (int t = 0; t < k; t++)
+    {
+        if (teams[t].total_score > mean + tol || teams[t].total_score < mean - tol)
+        {
+            outside++;
+        }
+    }
+    if (outside > 0)
+    {
+        write_line(to_string(outside) + " team totals ended outside " + to_string((int)(PARTITION_TOTAL_TOLERANCE * 100)) + "% of the mean.");
+    }
+
+    preference_summary p = measure_preferences(g, teams);
+    write_line("Partitioned into " + to_string(k) + " teams over " + to_string(levels.size()) + " levels: " + to_string(p.wants_met) + " of " + to_string(p.wants) + " wants met, " + to_string(p.avoids_broken) + " of " + to_string(p.avoids) + " avoids broken.");
+    return teams;
+}
@@ -0,0 +1,32 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "preferences.h"
+#include <vector>
+
+using std::vector;
+
+// how far a team total may sit from the mean total, as a fraction of the mean
+const double PARTITION_TOTAL_TOLERANCE = 0.05;
+
+// coarsening stops once there are this many vertices per team or fewer
+const int COARSEN_VERTICES_PER_TEAM = 2;
+
+// refinement passes over the boundary vertices at every level
+const int REFINE_PASSES = 6;
+
+// an apart rule becomes an edge this negative, no realistic number of wants outweighs it
+const int APART_EDGE_WEIGHT = -1000;
+
+/**
+ * Allocate num_teams teams that keep as many of the preferences in g as possible, multilevel style:
+ * coarsen by heavy-edge matching, partition the coarsest graph greedily, then refine the boundary
+ * vertices at every level on the way back up.
+ * Team sizes end up within one of each other and team totals stay within PARTITION_TOTAL_TOLERANCE
+ * of the mean while refining and evening out sizes, unless a pin or a role leaves no other move; any team
+ * that still ends outside the band is reported. A move never takes a team's last holder of a role, and
+ * ensure_leader_present runs at the end. Pins are hard. Apart rules are very negative edges, and
+ * broken ones are reported like allocate_teams does. Student i must have id i (the ids index g).
+ */
+vector<team> allocate_teams_partitioned(const vector<student> &students, const preference_graph &g, int num_teams, const constraint_store *cs = nullptr);
@@ -0,0 +1,340 @@
+// including relevant libraries
+#include "preferences.h"
+#include "mapped_file.h"
+#include "io.h"
+#include "splashkit.h"
+#include <unordered_map>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * the cells of one line, trimmed (preference files never need quoted fields)
+ */
+static void split_preference_line(const char *begin, const char *end, vector<string> &cells)
+{
+    cells.clear();
+    const char *cell = begin;
+
+    for (const char *p = begin; p <= end; p++)
+    {
+        if (p == end || *p == ',')
+        {
+            const char *a = cell;
+            const char *b = p;
+            while (a < b && (*a == ' ' || *a == '\t'))
+            {
+                a++;
+            }
+            while (b > a && (b[-1] == ' ' || b[-1] == '\t' || b[-1] == '\r'))
+            {
+                b--;
+            }
+            cells.push_back(string(a, b));
+            cell = p + 1;
+        }
+    }
+}
+
+/**
+ * read want and avoid lines from the preferences csv (mapped, so a million lines is one pass over memory)
+ */
+bool load_preferences_csv(const string &filename, preference_store &out)
+{
+    mapped_file file;
+    if (!map_file(filename, file))
+    {
+        return false;
+    }
+
+    out.names.clear();
+    out.from.clear();
+    out.to.clear();
+    out.weight.clear();
+
+    std::unordered_map<string, int> index;
+    auto name_index = [&](const string &name)
+    {
+        auto found = index.find(name);
+        if (found != index.end())
+        {
+            return found->second;
+        }
+        int id = out.names.size();
+        out.names.push_back(name);
+        index[name] = id;
+        return id;
+    };
+
+    vector<string> cells;
+    const char *pos = file.data;
+    const char *end = file.data + file.size;
+    int line_number = 0;
+    int ignored = 0;
+
+    while (pos < end)
+    {
+        const char *line_end = pos;
+        while (line_end < end && *line_end != '\n')
+        {
+            line_end++;
+        }
+        line_number++;
+
+        const char *line_begin = pos;
+        split_preference_line(pos, line_end, cells);
+        pos = line_end + 1;
+
+        if (cells.size() == 1 && cells[0].empty())
+        {
+            continue;
+        }
+
+        string kind = cells[0];
+        for (int i = 0; i < kind.size(); i++)
+        {
+            kind[i] = tolower((unsigned char)kind[i]);
+        }
+
+        int sign = (kind == "want") ? 1 : (kind == "avoid") ? -1 : 0;
+        int weight = (cells.size() >= 4) ? safe_stoi(cells[3], 0) : 1;
+
+        if (sign == 0 || cells.size() < 3 || weight <= 0 || cells[1] == cells[2])
+        {
+            // line 1 is allowed to be a header, the rest are reported (only the first few)
+            if (line_number > 1 && ignored++ < 10)
+            {
+                write_line("Preferences line " + to_string(line_number) + " ignored: " + string(line_begin, line_end));
+            }
+            continue;
+        }
+
+        out.from.push_back(name_index(cells[1]));
+        out.to.push_back(name_index(cells[2]));
+        out.weight.push_back(sign * weight);
+    }
+
+    unmap_file(file);
+
+    if (ignored > 10)
+    {
+        write_line(to_string(ignored) + " preference lines ignored in total.");
+    }
+    write_line("Loaded " + to_string(out.weight.size()) + " preferences between " + to_string(out.names.size()) + " students from " + filename);
+    return true;
+}
+
+/**
+ * "cohort.csv" -> "cohort_preferences.csv"
+ */
+string preferences_path_for(const string &csv_path)
+{
+    string base = csv_path;
+    if (base.size() >= 4 && base.compare(base.size() - 4, 4, ".csv") == 0)
+    {
+        base.erase(base.size() - 4);
+    }
+    return base + "_preferences.csv";
+}
+
+/**
+ * counting sort into rows, then merge repeats inside each row with a marker array
+ */
+void build_graph_rows(int n, const vector<weighted_edge> &edges, preference_graph &g)
+{
+    g.n = n;
+    g.start.assign(n + 1, 0);
+
+    // both directions of every edge
+    for (int e = 0; e < edges.size(); e++)
+    {
+        if (edges[e].u != edges[e].v)
+        {
+            g.start[edges[e].u + 1]++;
+            g.start[edges[e].v + 1]++;
+        }
+    }
+    for (int v = 0; v < n; v++)
+    {
+        g.start[v + 1] += g.start[v];
+    }
+
+    vector<int> fill(g.start.begin(), g.start.end() - 1);
+    g.adj.assign(g.start[n], 0);
+    g.weight.assign(g.start[n], 0);
+    for (int e = 0; e < edges.size(); e++)
+    {
+        const weighted_edge &ed = edges[e];
+        if (ed.u == ed.v)
+        {
+            continue;
+        }
+        g.adj[fill[ed.u]] = ed.v;
+        g.weight[fill[ed.u]++] = ed.w;
+        g.adj[fill[ed.v]] = ed.u;
+        g.weight[fill[ed.v]++] = ed.w;
+    }
+
+    // compact each row in place: marker[x] = where x already sits in the row being written
+    vector<int> marker(n, -1);
+    int out = 0;
+    for (int v = 0; v < n; v++)
+    {
+        int row_begin = out;
+        for (int e = g.start[v]; e < g.start[v + 1]; e++)
+        {
+            int x = g.adj[e];
+            if (marker[x] >= row_begin)
+            {
+                g.weight[marker[x]] += g.weight[e];
+            }
+            else
+            {
+                marker[x] = out;
+                g.adj[out] = x;
+                g.weight[out] = g.weight[e];
+                out++;
+            }
+        }
+
+        // drop pairs whose wants and avoids cancelled out (and clear the markers for the next row)
+        int kept = row_begin;
+        for (int e = row_begin; e < out; e++)
+        {
+            marker[g.adj[e]] = -1;
+            if (g.weight[e] != 0)
+            {
+                g.adj[kept] = g.adj[e];
+                g.weight[kept] = g.weight[e];
+                kept++;
+            }
+        }
+        out = kept;
+        g.start[v] = row_begin;
+    }
+    g.start[n] = out;
+    g.adj.resize(out);
+    g.weight.resize(out);
+}
+
+/**
+ * resolve names to ids and build the graph for this cohort
+ */
+void build_preference_graph(const preference_store &ps, const vector<student> &students, preference_graph &g)
+{
+    std::unordered_map<string, int> by_name;
+    for (int i = students.size() - 1; i >= 0; i--)
+    {
+        by_name[students[i].name] = i;
+    }
+
+    // one lookup per distinct name, not per edge
+    vector<int> id_of(ps.names.size(), -1);
+    for (int i = 0; i < ps.names.size(); i++)
+    {
+        auto found = by_name.find(ps.names[i]);
+        if (found != by_name.end())
+        {
+            id_of[i] = found->second;
+        }
+    }
+
+    vector<weighted_edge> edges;
+    edges.reserve(ps.weight.size());
+    int unknown = 0;
+    for (int e = 0; e < ps.weight.size(); e++)
+    {
+        int u = id_of[ps.from[e]];
+        int v = id_of[ps.to[e]];
+        if (u == -1 || v == -1)
+        {
+            unknown++;
+            continue;
+        }
+        edges.push_back({u, v, ps.weight[e]});
+    }
+
+    if (unknown > 0)
+    {
+        write_line(to_string(unknown) + " preferences name students who aren't in the cohort, skipped.");
+    }
+
+    build_graph_rows(students.size(), edges, g);
+}
+
+/**
+ * zero the edges both ways instead of moving rows around, so start stays valid
+ */
+void drop_graph_vertex(preference_graph &g, int v)
+{
+    if (v < 0 || v >= g.n)
+    {
+        return;
+    }
+
+    for (int e = g.start[v]; e < g.start[v + 1]; e++)
+    {
+        // the rows are merged, so the way back is a single entry in the neighbour's row
+        int u = g.adj[e];
+        for (int back = g.start[u]; back < g.start[u + 1]; back++)
+        {
+            if (g.adj[back] == v)
+            {
+                g.weight[back] = 0;
+            }
+        }
+        g.weight[e] = 0;
+    }
+}
+
+/**
+ * check every pair once against the team each student ended up in
+ */
+preference_summary measure_preferences(const preference_graph &g, const vector<team> &teams)
+{
+    preference_summary summary = {0, 0, 0, 0, 0};
+
+    vector<int> team_of(g.n, -1);
+    for (int t = 0; t < teams.size(); t++)
+    {
+        for (int m = 0; m < teams[t].members.size(); m++)
+        {
+            int id = teams[t].members[m].id;
+            if (id >= 0 && id < g.n)
+            {
+                team_of[id] = t;
+            }
+        }
+    }
+
+    for (int u = 0; u < g.n; u++)
+    {
+        for (int e = g.start[u]; e < g.start[u + 1]; e++)
+        {
+            int v = g.adj[e];
+            if (v < u || g.weight[e] == 0)
+            {
+                continue;
+            }
+
+            bool together = (team_of[u] != -1 && team_of[u] == team_of[v]);
+            if (g.weight[e] > 0)
+            {
+                summary.wants++;
+                summary.wants_met += together ? 1 : 0;
+            }
+            else
+            {
+                summary.avoids++;
+                summary.avoids_broken += together ? 1 : 0;
+            }
+            if (together)
+            {
+                summary.satisfied += g.weight[e];
+            }
+        }
+    }
+
+    return summary;
+}
@@ -0,0 +1,84 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include <vector>
+#include <string>
+
+using std::vector;
+
+/**
+ * "want to work with" and "don't want to work with" preferences.
+ * like constraint_store they are kept by name so they survive a reload, every name is stored once
+ * and the edges point into that table (a million edges would be a lot of repeated strings otherwise)
+ */
+struct preference_store
+{
+    vector<std::string> names; // every name mentioned, once
+    vector<int> from;          // index into names
+    vector<int> to;            // index into names
+    vector<int> weight;        // > 0 want, < 0 avoid
+};
+
+// one undirected weighted edge between two students (by id)
+struct weighted_edge
+{
+    int u;
+    int v;
+    int w;
+};
+
+// symmetric weighted graph over student ids in compressed rows, both directions of a pair are merged
+struct preference_graph
+{
+    int n;
+    vector<int> start;  // n + 1 row offsets into adj
+    vector<int> adj;    // neighbour ids
+    vector<int> weight; // summed weight of every preference between the two (0 = dropped since the build)
+};
+
+// how a set of teams does on the preferences
+struct preference_summary
+{
+    long long wants;         // pairs with a positive weight
+    long long wants_met;     // ... that share a team
+    long long avoids;        // pairs with a negative weight
+    long long avoids_broken; // ... that share a team anyway
+    long long satisfied;     // summed weight of every pair that shares a team
+};
+
+/**
+ * Read a preferences CSV with lines "want,<name>,<name>[,weight]" and "avoid,<name>,<name>[,weight]".
+ * The weight defaults to 1. A header line and blank lines are skipped.
+ *
+ * @returns false if the file couldn't be opened
+ */
+bool load_preferences_csv(const std::string &filename, preference_store &out);
+
+/**
+ * Sidecar name for a cohort file: "cohort.csv" -> "cohort_preferences.csv".
+ */
+std::string preferences_path_for(const std::string &csv_path);
+
+/**
+ * Build the rows of a graph on n vertices from an undirected edge list in O(n + edges).
+ * Duplicate pairs are summed, self loops and pairs that sum to zero are dropped.
+ */
+void build_graph_rows(int n, const vector<weighted_edge> &edges, preference_graph &g);
+
+/**
+ * Match the preferences against a cohort (first student with each name) and build the graph.
+ * Edges with an unknown name are counted and reported once.
+ */
+void build_preference_graph(const preference_store &ps, const vector<student> &students, preference_graph &g);
+
+/**
+ * Drop every edge of vertex v in place (a withdrawn student), O(degree of v and of its neighbours).
+ * The rows keep their size, the dropped edges are left with weight 0 and skipped.
+ */
+void drop_graph_vertex(preference_graph &g, int v);
+
+/**
+ * Count met wants and broken avoids for teams whose member ids index g.
+ */
+preference_summary measure_preferences(const preference_graph &g, const vector<team> &teams);
@@ -0,0 +1,149 @@
+// including relevant libraries
+#include "roles.h"
+#include "scoring.h"
+#include "allocator.h"
+#include "io.h"
+#include "splashkit.h"
+#include <fstream>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * the rule table, the leader rule is first and stays there
+ */
+static vector<role_rule> &active_rules()
+{
+    static vector<role_rule> rules = {{"leader", SKILL_LEADERSHIP, LEADER_THRESHOLD}};
+    return rules;
+}
+
+const vector<role_rule> &role_rules()
+{
+    return active_rules();
+}
+
+unsigned required_roles()
+{
+    return (1u << active_rules().size()) - 1;
+}
+
+void set_extra_role_rules(const vector<role_rule> &extra)
+{
+    vector<role_rule> &rules = active_rules();
+    rules.resize(1);
+
+    for (int i = 0; i < extra.size(); i++)
+    {
+        if (rules.size() == MAX_ROLES)
+        {
+            write_line("Only " + to_string(MAX_ROLES) + " roles are supported, ignoring the rest.");
+            break;
+        }
+        rules.push_back(extra[i]);
+    }
+}
+
+/**
+ * skill column name -> skill_index (-1 if it isn't one)
+ */
+static int skill_from_name(string name)
+{
+    for (int i = 0; i < name.size(); i++)
+    {
+        name[i] = tolower((unsigned char)name[i]);
+    }
+
+    const char *names[NUM_SKILLS] = {"leadership", "frontend", "backend", "security", "ui", "english"};
+    for (int i = 0; i < NUM_SKILLS; i++)
+    {
+        if (name == names[i])
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+bool load_role_rules_csv(const string &filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open())
+    {
+        return false;
+    }
+
+    vector<role_rule> extra;
+    string line;
+    int line_number = 0;
+    while (std::getline(file, line))
+    {
+        line_number++;
+
+        size_t first = line.find(',');
+        size_t second = (first == string::npos) ? string::npos : line.find(',', first + 1);
+        if (second == string::npos)
+        {
+            continue;
+        }
+
+        role_rule rule;
+        rule.name = trim_string(line.substr(0, first));
+        rule.skill = skill_from_name(trim_string(line.substr(first + 1, second - first - 1)));
+        rule.threshold = safe_stoi(trim_string(line.substr(second + 1)), 0);
+
+        // line 1 is allowed to be a header
+        if (rule.skill == -1 || rule.threshold <= 0)
+        {
+            if (line_number > 1)
+            {
+                write_line("Role rules line " + to_string(line_number) + " ignored: " + line);
+            }
+            continue;
+        }
+        extra.push_back(rule);
+    }
+
+    set_extra_role_rules(extra);
+    write_line("Loaded " + to_string(extra.size()) + " extra role rules from " + filename);
+    return true;
+}
+
+/**
+ * "cohort.csv" -> "cohort_roles.csv"
+ */
+string roles_path_for(const string &csv_path)
+{
+    string base = csv_path;
+    if (base.size() >= 4 && base.compare(base.size() - 4, 4, ".csv") == 0)
+    {
+        base.erase(base.size() - 4);
+    }
+    return base + "_roles.csv";
+}
+
+unsigned compute_role_mask(const student &s)
+{
+    const vector<role_rule> &rules = active_rules();
+    int lanes[SKILL_LANES];
+    student_skill_lanes(s, lanes);
+
+    unsigned mask = 0;
+    for (int r = 0; r < rules.size(); r++)
+    {
+        if (lanes[rules[r].skill] >= rules[r].threshold)
+        {
+            mask |= (1u << r);
+        }
+    }
+    return mask;
+}
+
+void assign_roles(vector<student> &students)
+{
+    for (int i = 0; i < students.size(); i++)
+    {
+        students[i].roles = compute_role_mask(students[i]);
+    }
+}
@@ -0,0 +1,54 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+
+using std::vector;
+
+// a role is covered by anyone whose skill is at or above the threshold
+struct role_rule
+{
+    std::string name;
+    int skill;     // skill_index
+    int threshold;
+};
+
+/**
+ * The active role rules. Role 0 is always "leader" (leadership >= LEADER_THRESHOLD), so with no
+ * extra rules every team just needs a leader like before.
+ */
+const vector<role_rule> &role_rules();
+
+/**
+ * One bit per active rule, the roles every team should cover.
+ */
+unsigned required_roles();
+
+/**
+ * Replace the rules that come after the leader rule (at most MAX_ROLES - 1 of them).
+ * Students have to be rescored (or assign_roles called) for their masks to follow.
+ */
+void set_extra_role_rules(const vector<role_rule> &extra);
+
+/**
+ * Read extra rules from a CSV with lines "<name>,<skill column>,<threshold>", e.g. "backend,backend,8".
+ *
+ * @returns false if the file couldn't be opened
+ */
+bool load_role_rules_csv(const std::string &filename);
+
+/**
+ * Sidecar name for a cohort file: "cohort.csv" -> "cohort_roles.csv".
+ */
+std::string roles_path_for(const std::string &csv_path);
+
+/**
+ * The role mask of one student under the active rules.
+ */
+unsigned compute_role_mask(const student &s);
+
+/**
+ * Fill in .roles for every student.
+ */
+void assign_roles(vector<student> &students);
@@ -0,0 +1,373 @@
+// including relevant libraries
+#include "rotation.h"
+#include "allocator.h"
+#include "splashkit.h"
+#include <algorithm>
+#include <atomic>
+#include <random>
+#include <thread>
+
+using std::to_string;
+using std::vector;
+
+void history_reset(pair_history &h, int n)
+{
+    h.n = n;
+    h.dense = (n <= DENSE_HISTORY_LIMIT);
+    h.table.assign(h.dense ? (size_t)n * n : 0, 0);
+    h.sparse.clear();
+}
+
+int pair_count(const pair_history &h, int a, int b)
+{
+    if (a < 0 || b < 0 || a >= h.n || b >= h.n || a == b)
+    {
+        return 0;
+    }
+
+    if (h.dense)
+    {
+        return h.table[(size_t)a * h.n + b];
+    }
+
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+    auto found = h.sparse.find((unsigned long long)a * h.n + b);
+    return (found == h.sparse.end()) ? 0 : found->second;
+}
+
+/**
+ * one more round together for a and b (counts stop at 255)
+ */
+static void bump_pair(pair_history &h, int a, int b)
+{
+    if (a < 0 || b < 0 || a >= h.n || b >= h.n || a == b)
+    {
+        return;
+    }
+
+    if (h.dense)
+    {
+        unsigned char &ab = h.table[(size_t)a * h.n + b];
+        if (ab < 255)
+        {
+            ab++;
+            h.table[(size_t)b * h.n + a] = ab;
+        }
+        return;
+    }
+
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+    unsigned char &count = h.sparse[(unsigned long long)a * h.n + b];
+    if (count < 255)
+    {
+        count++;
+    }
+}
+
+void record_round(pair_history &h, const vector<team> &teams)
+{
+    for (int t = 0; t < teams.size(); t++)
+    {
+        const vector<student> &m = teams[t].members;
+        for (int i = 0; i < m.size(); i++)
+        {
+            for (int j = i + 1; j < m.size(); j++)
+            {
+                bump_pair(h, m[i].id, m[j].id);
+            }
+        }
+    }
+}
+
+long long repeat_pairs(const pair_history &h, const vector<team> &teams)
+{
+    long long repeats = 0;
+    for (int t = 0; t < teams.size(); t++)
+    {
+        const vector<student> &m = teams[t].members;
+        for (int i = 0; i < m.size(); i++)
+        {
+            for (int j = i + 1; j < m.size(); j++)
+            {
+                repeats += pair_count(h, m[i].id, m[j].id);
+            }
+        }
+    }
+    return repeats;
+}
+
+// how often each member of a pair of teams met their own team and the other team before (reused between pairs)
+struct pair_meetings
+{
+    vector<int> own_a, own_b;     // met the rest of their own team
+    vector<int> other_a, other_b; // met the members of the other team
+    vector<int> cross;            // a member x b member, row per a member
+};
+
+/**
+ * tally the earlier meetings inside and across teams a and b, O(team size squared) lookups
+ */
+static void count_meetings(const vector<team> &teams, int a, int b, const pair_history &h, pair_meetings &pm)
+{
+    const vector<student> &A = teams[a].members;
+    const vector<student> &B = teams[b].members;
+    int na = A.size();
+    int nb = B.size();
+
+    pm.own_a.assign(na, 0);
+    pm.own_b.assign(nb, 0);
+    pm.other_a.assign(na, 0);
+    pm.other_b.assign(nb, 0);
+    pm.cross.assign((size_t)na * nb, 0);
+
+    for (int i = 0; i < na; i++)
+    {
+        for (int x = i + 1; x < na; x++)
+        {
+            int c = pair_count(h, A[i].id, A[x].id);
+            pm.own_a[i] += c;
+            pm.own_a[x] += c;
+        }
+    }
+    for (int j = 0; j < nb; j++)
+    {
+        for (int x = j + 1; x < nb; x++)
+        {
+            int c = pair_count(h, B[j].id, B[x].id);
+            pm.own_b[j] += c;
+            pm.own_b[x] += c;
+        }
+    }
+    for (int i = 0; i < na; i++)
+    {
+        for (int j = 0; j < nb; j++)
+        {
+            int c = pair_count(h, A[i].id, B[j].id);
+            pm.cross[(size_t)i * nb + j] = c;
+            pm.other_a[i] += c;
+            pm.other_b[j] += c;
+        }
+    }
+}
+
+/**
+ * apply the swap between teams a and b that lowers the balance metric plus repeat_units per repeated
+ * pairing the most. each swap is O(1) on top of the tallies: a's member trades the meetings in its
+ * own team for the ones in b (minus the member it swaps with), and the same the other way round
+ */
+static bool improve_pair_with_history(vector<team> &teams, int a, int b, const pair_history &h, long long repeat_units, const constraint_store *cs, team_masks &masks, balance_mode mode, pair_meetings &pm)
+{
+    team &A = teams[a];
+    team &B = teams[b];
+    int na = A.members.size();
+    int nb = B.members.size();
+    if (na == 0 || nb == 0)
+    {
+        return false;
+    }
+
+    count_meetings(teams, a, b, h, pm);
+
+    pair_delta_context ctx;
+    begin_pair_delta(ctx, teams, a, b, mode);
+
+    long long best_delta = 0;
+    int best_i = -1;
+    int best_j = -1;
+
+    for (int i = 0; i < na; i++)
+    {
+        const student &sa = A.members[i];
+        for (int j = 0; j < nb; j++)
+        {
+            const student &sb = B.members[j];
+            if (cs != nullptr && !swap_allowed(cs, masks, a, sa, b, sb))
+            {
+                continue;
+            }
+
+            int met_together = pm.cross[(size_t)i * nb + j];
+            long long repeats = pm.other_a[i] + pm.other_b[j] - 2 * met_together - pm.own_a[i] - pm.own_b[j];
+            long long delta = pair_swap_delta(ctx, sa, sb) + repeat_units * repeats;
+
+            if (delta < best_delta)
+            {
+                best_delta = delta;
+                best_i = i;
+                best_j = j;
+            }
+        }
+    }
+
+    if (best_i == -1)
+    {
+        return false;
+    }
+
+    if (cs != nullptr)
+    {
+        mask_toggle(cs, masks, a, A.members[best_i]);
+        mask_toggle(cs, masks, a, B.members[best_j]);
+        mask_toggle(cs, masks, b, B.members[best_j]);
+        mask_toggle(cs, masks, b, A.members[best_i]);
+    }
+    swap_members(A, best_i, B, best_j);
+    return true;
+}
+
+/**
+ * one candidate for a round: a shuffled greedy allocation, roles fixed, then swap passes over every pair of teams
+ */
+static rotation_round build_candidate(const vector<student> &cohort, const vector<int> &by_score, int k, const pair_history &h, long long repeat_units, unsigned seed, const constraint_store *cs, balance_mode mode)
+{
+    // the greedy hands each block of k students out one per team, so shuffling inside a block
+    // gives different teammates without giving up the balance
+    vector<int> order = by_score;
+    std::mt19937 rng(seed);
+    for (int start = 0; start < order.size(); start += k)
+    {
+        int end = std::min((int)order.size(), start + k);
+        std::shuffle(order.begin() + start, order.begin() + end, rng);
+    }
+
+    rotation_round r;
+    r.teams = allocate_teams_in_order(cohort, order, k, cs);
+    ensure_leader_present(r.teams, false, cs);
+
+    team_masks masks;
+    if (cs != nullptr)
+    {
+        build_team_masks(*cs, r.teams, masks);
+    }
+
+    pair_meetings pm;
+    for (int pass = 0; pass < ROTATION_PASSES; pass++)
+    {
+        bool improved = false;
+        for (int a = 0; a < k; a++)
+        {
+            for (int b = a + 1; b < k; b++)
+            {
+                if (improve_pair_with_history(r.teams, a, b, h, repeat_units, cs, masks, mode, pm))
+                {
+                    improved = true;
+                }
+            }
+        }
+
+        if (!improved)
+        {
+            break;
+        }
+    }
+
+    r.metric = compute_balance_metric(r.teams, mode);
+    r.repeats = repeat_pairs(h, r.teams);
+    return r;
+}
+
+/**
+ * generate the rounds of a rotation (see rotation.h)
+ */
+vector<rotation_round> schedule_rotations(const vector<student> &students, int num_teams, int rounds, long long repeat_penalty, int num_threads, const constraint_store *cs, balance_mode mode)
+{
+    vector<rotation_round> schedule;
+
+    if (students.empty() || num_teams <= 0 || num_teams > students.size() || rounds <= 0)
+    {
+        write_line("Rotation needs students, between 1 and " + to_string(students.size()) + " teams and at least one round.");
+        return schedule;
+    }
+
+    // the history is indexed by id, so ids have to be positions in the cohort
+    vector<student> cohort = students;
+    for (int i = 0; i < cohort.size(); i++)
+    {
+        cohort[i].id = i;
+    }
+
+    cs = has_constraints(cs) ? cs : nullptr;
+    vector<int> by_score = order_by_score(cohort);
+
+    // same units as the role penalty: one repeat costs repeat_penalty points of variance
+    long long k = num_teams;
+    long long repeat_units = repeat_penalty * SCORE_SCALE * SCORE_SCALE * k * k;
+
+    pair_history history;
+    history_reset(history, cohort.size());
+
+    if (num_threads <= 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (num_threads > ROTATION_CANDIDATES)
+    {
+        num_threads = ROTATION_CANDIDATES;
+    }
+
+    for (int round = 0; round < rounds; round++)
+    {
+        // the candidates only read the cohort and the history, each thread takes the next one as it finishes
+        vector<rotation_round> candidates(ROTATION_CANDIDATES);
+        std::atomic<int> next(0);
+        auto worker = [&]()
+        {
+            int c;
+            while ((c = next.fetch_add(1)) < candidates.size())
+            {
+                unsigned seed = round * ROTATION_CANDIDATES + c + 1;
+                candidates[c] = build_candidate(cohort, by_score, num_teams, history, repeat_units, seed, cs, mode);
+            }
+        };
+
+        vector<std::thread> workers;
+        for (int t = 1; t < num_threads; t++)
+        {
+            workers.push_back(std::thread(worker));
+        }
+        worker();
+
+        for (int t = 0; t < workers.size(); t++)
+        {
+            workers[t].join();
+        }
+
+        // lowest objective wins, ties go to the earlier candidate so the schedule is repeatable
+        // (128 bits, repeat_units is k^2 scaled like the role penalty and a big cohort has many repeats)
+        int best = 0;
+        for (int c = 1; c < candidates.size(); c++)
+        {
+            __int128 objective = candidates[c].metric + (__int128)repeat_units * candidates[c].repeats;
+            __int128 best_objective = candidates[best].metric + (__int128)repeat_units * candidates[best].repeats;
+            if (objective < best_objective)
+            {
+                best = c;
+            }
+        }
+
+        record_round(history, candidates[best].teams);
+        schedule.push_back(candidates[best]);
+    }
+
+    return schedule;
+}
+
+/**
+ * print the schedule summary to the console
+ */
+void print_rotation_summary(const vector<rotation_round> &rounds)
+{
+    write_line("round | variance | repeated pairings");
+
+    for (int r = 0; r < rounds.size(); r++)
+    {
+        double variance = metric_to_variance(rounds[r].metric, rounds[r].teams.size());
+        write_line(to_string(r + 1) + " | " + to_string(variance) + " | " + to_string(rounds[r].repeats));
+    }
+}
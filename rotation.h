@@ -0,0 +1,65 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include <vector>
+#include <unordered_map>
+
+using std::vector;
+
+// up to this many students the pair history is a plain n x n table (16 MB at the limit), above it a hash of the pairs that met
+const int DENSE_HISTORY_LIMIT = 4096;
+
+// cost of one repeated pairing, in variance units of whole points (like the role penalty)
+const long long DEFAULT_REPEAT_PENALTY = 10;
+
+// starting allocations tried for every round, the best one after optimising is kept
+const int ROTATION_CANDIDATES = 4;
+
+// how many times each round goes over every pair of teams at most
+const int ROTATION_PASSES = 8;
+
+// how many earlier rounds each pair of students (by id) shared a team in
+struct pair_history
+{
+    int n;
+    bool dense;
+    vector<unsigned char> table;                                  // n x n, used when dense
+    std::unordered_map<unsigned long long, unsigned char> sparse; // key lower id * n + higher id
+};
+
+// Empty the history for a cohort of n students.
+void history_reset(pair_history &h, int n);
+
+// Rounds students a and b were teammates in so far.
+int pair_count(const pair_history &h, int a, int b);
+
+// Add every pair of teammates in teams to the history.
+void record_round(pair_history &h, const vector<team> &teams);
+
+// Sum of pair_count over every pair of teammates, 0 if nobody meets again.
+long long repeat_pairs(const pair_history &h, const vector<team> &teams);
+
+// one allocation of the rotation and how it scored
+struct rotation_round
+{
+    vector<team> teams;
+    long long metric;  // compute_balance_metric of the round
+    long long repeats; // repeat_pairs against the rounds before it
+};
+
+/**
+ * Build rounds successive allocations of num_teams teams, each one minimising the balance metric
+ * plus repeat_penalty per repeated pairing. For every round ROTATION_CANDIDATES starting allocations
+ * are optimised with swaps across num_threads threads (<= 0 uses every core) and the best is kept,
+ * so the result doesn't depend on the thread count. students must have scores computed.
+ *
+ * @returns one entry per round, empty if the input is unusable
+ */
+vector<rotation_round> schedule_rotations(const vector<student> &students, int num_teams, int rounds, long long repeat_penalty, int num_threads, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Print one line per round: variance and repeated pairings.
+ */
+void print_rotation_summary(const vector<rotation_round> &rounds);
@@ -3,25 +3,161 @@
 #include "splashkit.h"
 #include "scoring.h"
 #include "utilities.h"
+#include "roles.h"
 #include <vector>
+#include <cmath>
 
 using std::to_string;
 using std::vector;
 
+/**
+ * keep a skill value inside the table range so bad data can never index outside it
+ */
+static int clamp_skill(int value)
+{
+    if (value < 0)
+    {
+        return 0;
+    }
+
+    if (value > SKILL_LEVELS - 1)
+    {
+        return SKILL_LEVELS - 1;
+    }
+
+    return value;
+}
+
+/**
+ * a rule that just multiplies the skill by its weight
+ */
+skill_rule linear_skill_rule(double weight)
+{
+    skill_rule r;
+    r.weight = weight;
+    r.cap = SKILL_LEVELS - 1;
+    r.bonus_from = 0;
+    r.bonus = 0.0;
+    return r;
+}
+
+/**
+ * turn the per-skill rules into lookup tables. each entry is the contribution of that
+ * skill level in 1/SCORE_SCALE steps, so scoring later is only table adds
+ */
+scoring_rubric compile_rubric(const skill_rule rules[NUM_SKILLS])
+{
+    scoring_rubric rubric;
+
+    for (int skill = 0; skill < NUM_SKILLS; skill++)
+    {
+        const skill_rule &r = rules[skill];
+
+        for (int level = 0; level < SKILL_LEVELS; level++)
+        {
+            // capped linear part
+            int capped = level;
+            if (capped > r.cap)
+            {
+                capped = r.cap;
+            }
+
+            double value = r.weight * capped;
+
+            // convex bonus for specialists
+            if (r.bonus_from > 0 && level >= r.bonus_from)
+            {
+                int steps = level - r.bonus_from + 1;
+                value += r.bonus * steps * steps;
+            }
+
+            // round to the nearest fixed point step
+            rubric.table[skill][level] = (int)std::lround(value * SCORE_SCALE);
+        }
+    }
+
+    return rubric;
+}
+
+/**
+ * the rubric for the standard weightages, compiled once and reused
+ */
+const scoring_rubric &default_rubric()
+{
+    static const skill_rule rules[NUM_SKILLS] = {
+        linear_skill_rule(W_LEAD),
+        linear_skill_rule(W_FRONT),
+        linear_skill_rule(W_BACK),
+        linear_skill_rule(W_SEC),
+        linear_skill_rule(W_UI),
+        linear_skill_rule(W_ENG)};
+
+    static const scoring_rubric rubric = compile_rubric(rules);
+    return rubric;
+}
+
+/**
+ * score a student using the rubric tables
+ */
+int compute_student_score_rubric(const student &s, const scoring_rubric &rubric)
+{
+    int sum = 0;
+    sum += rubric.table[SKILL_LEADERSHIP][clamp_skill(s.leadership)];
+    sum += rubric.table[SKILL_FRONTEND][clamp_skill(s.frontend)];
+    sum += rubric.table[SKILL_BACKEND][clamp_skill(s.backend)];
+    sum += rubric.table[SKILL_SECURITY][clamp_skill(s.security)];
+    sum += rubric.table[SKILL_UI][clamp_skill(s.ui)];
+    sum += rubric.table[SKILL_ENGLISH][clamp_skill(s.english)];
+
+    // already fixed point, nothing is truncated
+    return sum;
+}
+
+/**
+ * score everyone with the rubric (no printing so it stays fast for huge cohorts). role masks are
+ * filled in at the same time, so every scored student has them
+ */
+void compute_scores_with_rubric(vector<student> &students, const scoring_rubric &rubric)
+{
+    for (int i = 0; i < students.size(); i++)
+    {
+        students[i].student_score = compute_student_score_rubric(students[i], rubric);
+        students[i].roles = compute_role_mask(students[i]);
+    }
+}
+
 /**
  * A function to calculate the score of a single student
  */
 int compute_student_score_int(const student &s)
 {
-    double score = 0.0;
-    score += s.english * W_ENG;
-    score += s.frontend * W_FRONT;
-    score += s.backend * W_BACK;
-    score += s.security * W_SEC;
-    score += s.ui * W_UI;
-    score += s.leadership * W_LEAD;
+    return compute_student_score_rubric(s, default_rubric());
+}
+
+/**
+ * show a fixed point score as a decimal with two places
+ */
+std::string format_score(long long fixed_score)
+{
+    std::string sign = "";
+    if (fixed_score < 0)
+    {
+        sign = "-";
+        fixed_score = -fixed_score;
+    }
 
-    return int(score);
+    // hundredths are exact because SCORE_SCALE divides 100
+    long long hundredths = fixed_score * (100 / SCORE_SCALE);
+    long long whole = hundredths / 100;
+    long long frac = hundredths % 100;
+
+    std::string frac_text = to_string(frac);
+    if (frac < 10)
+    {
+        frac_text = "0" + frac_text;
+    }
+
+    return sign + to_string(whole) + "." + frac_text;
 }
 
 
@@ -31,10 +167,7 @@ int compute_student_score_int(const student &s)
 void compute_scores_for_all(vector<student> &students)
 {
     // compute and store student_score for each student
-    for (int i = 0; i < students.size(); i++)
-    {
-        students[i].student_score = compute_student_score_int(students[i]);
-    }
+    compute_scores_with_rubric(students, default_rubric());
 
     write_line("Computed scores for " + to_string(students.size()) + " students.");
     write_line();
@@ -43,7 +176,7 @@ void compute_scores_for_all(vector<student> &students)
     write_line("Students and computed scores :");
     for (int i = 0; i < students.size(); i++)
     {
-        write_line(to_string(i + 1) + ". " + students[i].name + " | score: " + to_string(students[i].student_score) + " | leadership: " + to_string(students[i].leadership));
+        write_line(to_string(i + 1) + ". " + students[i].name + " | score: " + format_score(students[i].student_score) + " | leadership: " + to_string(students[i].leadership));
     }
 }
 
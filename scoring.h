@@ -14,10 +14,59 @@ const double W_SEC   = 0.15;
 const double W_UI    = 0.15;
 const double W_LEAD  = 0.15;
 
+// number of skill fields every student has
+const int NUM_SKILLS = 6;
 
-// Compute a single student's integer score from their skill fields.
+// skills are rated 1-10 (0 when missing), so every per-skill transform fits in 11 entries
+const int SKILL_LEVELS = 11;
+
+// order of the skills inside a rubric
+enum skill_index
+{
+    SKILL_LEADERSHIP,
+    SKILL_FRONTEND,
+    SKILL_BACKEND,
+    SKILL_SECURITY,
+    SKILL_UI,
+    SKILL_ENGLISH
+};
+
+// how a single skill contributes to the score
+struct skill_rule
+{
+    double weight;   // score per skill point
+    int cap;         // points above the cap are ignored (10 = no cap)
+    int bonus_from;  // level where the specialist bonus starts (0 = no bonus)
+    double bonus;    // bonus * (level - bonus_from + 1)^2 is added from bonus_from upwards
+};
+
+// a rubric compiled into one lookup table per skill
+struct scoring_rubric
+{
+    int table[NUM_SKILLS][SKILL_LEVELS];
+};
+
+// A plain linear rule with no cap and no bonus.
+skill_rule linear_skill_rule(double weight);
+
+// Compile per-skill rules (in skill_index order) into lookup tables.
+scoring_rubric compile_rubric(const skill_rule rules[NUM_SKILLS]);
+
+// The rubric matching the W_* weights above.
+const scoring_rubric &default_rubric();
+
+// Score a student with a compiled rubric (6 table lookups, fixed point result).
+int compute_student_score_rubric(const student &s, const scoring_rubric &rubric);
+
+// Score every student with a compiled rubric without printing anything (also fills in .roles).
+void compute_scores_with_rubric(vector<student> &students, const scoring_rubric &rubric);
+
+// Compute a single student's fixed point score from their skill fields.
 int compute_student_score_int(const student &s);
 
+// Format a fixed point score for display, e.g. 127 -> "6.35".
+std::string format_score(long long fixed_score);
+
 // Compute scores for every student in the vector and store into .student_score.
 void compute_scores_for_all(vector<student> &students);
 
@@ -0,0 +1,490 @@
+// including relevant libraries
+#include "snapshot.h"
+#include "mapped_file.h"
+#include "allocator.h"
+#include "scoring.h"
+#include "roles.h"
+#include "categories.h"
+#include "availability.h"
+#include <fstream>
+#include <filesystem>
+#include <cstring>
+#include <cstdio>
+
+using std::vector;
+using std::string;
+
+// "STASNAP" + layout version, and a marker to catch snapshots from a machine with other byte order
+const char SNAPSHOT_MAGIC[8] = {'S', 'T', 'A', 'S', 'N', 'A', 'P', '\0'};
+const uint32_t SNAPSHOT_BYTE_ORDER = 0x01020304;
+
+// fixed size header at the start of every snapshot. every section after it starts on an 8 byte
+// boundary so the columns can be read straight out of the mapping
+struct snapshot_header
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t csv_size;
+    int64_t csv_mtime;
+    uint64_t csv_hash;
+    uint64_t student_count;
+    uint64_t names_bytes;
+    uint32_t team_count; // 0 = no assignment stored
+    uint32_t category_count;
+    uint64_t category_bytes;
+    uint32_t availability_slots; // 0 = no availability stored
+    uint32_t reserved;
+};
+
+// layout after the header (n = student_count, each section padded to 8 bytes):
+//   uint8  skills[NUM_SKILLS][n]   one column per skill, in skill_index order
+//   int32  scores[n]
+//   uint8  leader[n]               1 if leadership >= LEADER_THRESHOLD
+//   uint32 name_offsets[n + 1]     name i is names[offsets[i] .. offsets[i + 1])
+//   char   names[names_bytes]
+//   uint8  categories[category_count][n]   value codes, one column per categorical column
+//   uint8  value_counts[category_count]
+//   char   category_table[category_bytes]  per column its name then its values, each ending in '\0'
+//   uint64 availability[n]         only if availability_slots > 0
+//   int32  team_of[n]              only if team_count > 0 (-1 = not in a team)
+
+/**
+ * round up to the next multiple of 8
+ */
+static uint64_t pad8(uint64_t bytes)
+{
+    return (bytes + 7) & ~(uint64_t)7;
+}
+
+/**
+ * total file size a snapshot with this header should have
+ */
+static uint64_t snapshot_size(const snapshot_header &h)
+{
+    uint64_t n = h.student_count;
+    uint64_t size = sizeof(snapshot_header);
+    size += pad8(n * NUM_SKILLS);
+    size += pad8(n * 4);
+    size += pad8(n);
+    size += pad8((n + 1) * 4);
+    size += pad8(h.names_bytes);
+    size += pad8(h.category_count * n);
+    size += pad8(h.category_count);
+    size += pad8(h.category_bytes);
+    if (h.availability_slots > 0)
+    {
+        size += n * 8;
+    }
+    if (h.team_count > 0)
+    {
+        size += pad8(n * 4);
+    }
+    return size;
+}
+
+/**
+ * "data.csv" -> "data.csv.snap"
+ */
+string snapshot_path_for(const string &csv_filename)
+{
+    return csv_filename + ".snap";
+}
+
+/**
+ * 64 bit FNV-1a style hash that eats 8 bytes per step, fast enough to run on every load
+ */
+uint64_t hash_bytes(const char *data, size_t size)
+{
+    const uint64_t PRIME = 0x100000001b3ULL;
+    uint64_t h = 0xcbf29ce484222325ULL ^ size;
+
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint64_t word;
+        std::memcpy(&word, data + i, 8);
+        h = (h ^ word) * PRIME;
+        h ^= h >> 29;
+    }
+
+    for (; i < size; i++)
+    {
+        h = (h ^ (unsigned char)data[i]) * PRIME;
+    }
+
+    return h;
+}
+
+/**
+ * size + modification time + content hash of a csv
+ */
+bool fingerprint_csv(const string &csv_filename, const char *data, size_t size, csv_fingerprint &out)
+{
+    std::error_code ec;
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(csv_filename, ec);
+
+    // error handling
+    if (ec)
+    {
+        return false;
+    }
+
+    out.size = size;
+    out.mtime = mtime.time_since_epoch().count();
+    out.hash = hash_bytes(data, size);
+    return true;
+}
+
+/**
+ * write one section and pad it to 8 bytes
+ */
+static void write_section(std::ofstream &out, const void *data, uint64_t bytes)
+{
+    static const char zeros[8] = {0};
+    if (data != nullptr)
+    {
+        out.write((const char *)data, bytes);
+        out.write(zeros, pad8(bytes) - bytes);
+    }
+    else
+    {
+        // just padding
+        out.write(zeros, bytes);
+    }
+}
+
+/**
+ * write the snapshot column by column
+ */
+bool write_cohort_snapshot(const string &snapshot_path, const csv_fingerprint &fingerprint, const vector<student> &students, const vector<team> *teams)
+{
+    uint64_t n = students.size();
+
+    // build the name table first, offsets are 32 bit so very large name tables are refused
+    vector<uint32_t> name_offsets(n + 1, 0);
+    uint64_t names_bytes = 0;
+    for (uint64_t i = 0; i < n; i++)
+    {
+        name_offsets[i] = names_bytes;
+        names_bytes += students[i].name.size();
+        if (names_bytes > 0xffffffffULL)
+        {
+            return false;
+        }
+    }
+    name_offsets[n] = names_bytes;
+
+    // the category names and values as one block of '\0' terminated strings
+    const vector<category_column> &categories = category_columns();
+    string category_table;
+    vector<uint8_t> value_counts(categories.size());
+    for (int c = 0; c < categories.size(); c++)
+    {
+        category_table.append(categories[c].name).push_back('\0');
+        for (int v = 0; v < categories[c].values.size(); v++)
+        {
+            category_table.append(categories[c].values[v]).push_back('\0');
+        }
+        value_counts[c] = categories[c].values.size();
+    }
+
+    snapshot_header h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic));
+    h.version = SNAPSHOT_VERSION;
+    h.byte_order = SNAPSHOT_BYTE_ORDER;
+    h.csv_size = fingerprint.size;
+    h.csv_mtime = fingerprint.mtime;
+    h.csv_hash = fingerprint.hash;
+    h.student_count = n;
+    h.names_bytes = names_bytes;
+    h.team_count = (teams != nullptr) ? teams->size() : 0;
+    h.category_count = categories.size();
+    h.category_bytes = category_table.size();
+    h.availability_slots = availability_slots();
+
+    string temp_path = snapshot_path + ".tmp";
+    std::ofstream out(temp_path.c_str(), std::ios::binary | std::ios::trunc);
+
+    // error handling (read only folder etc.)
+    if (!out.is_open())
+    {
+        return false;
+    }
+
+    out.write((const char *)&h, sizeof(h));
+
+    // skills, one column each
+    vector<uint8_t> column(n);
+    for (int skill = 0; skill < NUM_SKILLS; skill++)
+    {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            const student &s = students[i];
+            int value = 0;
+            switch (skill)
+            {
+            case SKILL_LEADERSHIP: value = s.leadership; break;
+            case SKILL_FRONTEND: value = s.frontend; break;
+            case SKILL_BACKEND: value = s.backend; break;
+            case SKILL_SECURITY: value = s.security; break;
+            case SKILL_UI: value = s.ui; break;
+            default: value = s.english; break;
+            }
+            column[i] = value;
+        }
+        out.write((const char *)column.data(), n);
+    }
+    // the skill columns are one section, so pad once after all of them
+    write_section(out, nullptr, pad8(n * NUM_SKILLS) - n * NUM_SKILLS);
+
+    // scores
+    vector<int32_t> scores(n);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        scores[i] = students[i].student_score;
+    }
+    write_section(out, scores.data(), n * 4);
+
+    // leader flags
+    for (uint64_t i = 0; i < n; i++)
+    {
+        column[i] = students[i].leadership >= LEADER_THRESHOLD;
+    }
+    write_section(out, column.data(), n);
+
+    // names
+    write_section(out, name_offsets.data(), (n + 1) * 4);
+    string names;
+    names.reserve(names_bytes);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        names += students[i].name;
+    }
+    write_section(out, names.data(), names_bytes);
+
+    // category codes, one column each like the skills
+    for (int c = 0; c < categories.size(); c++)
+    {
+        for (uint64_t i = 0; i < n; i++)
+        {
+            column[i] = students[i].category[c];
+        }
+        out.write((const char *)column.data(), n);
+    }
+    write_section(out, nullptr, pad8(h.category_count * n) - h.category_count * n);
+    write_section(out, value_counts.data(), h.category_count);
+    write_section(out, category_table.data(), h.category_bytes);
+
+    // availability masks
+    if (h.availability_slots > 0)
+    {
+        vector<uint64_t> masks(n);
+        for (uint64_t i = 0; i < n; i++)
+        {
+            masks[i] = students[i].availability;
+        }
+        write_section(out, masks.data(), n * 8);
+    }
+
+    // team assignment, looked up through the student ids
+    if (h.team_count > 0)
+    {
+        vector<int32_t> team_of(n, -1);
+        for (int t = 0; t < teams->size(); t++)
+        {
+            for (int m = 0; m < (*teams)[t].members.size(); m++)
+            {
+                int id = (*teams)[t].members[m].id;
+                if (id >= 0 && id < n)
+                {
+                    team_of[id] = t;
+                }
+            }
+        }
+        write_section(out, team_of.data(), n * 4);
+    }
+
+    out.close();
+    if (!out)
+    {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    // swap the finished file into place
+    std::error_code ec;
+    std::filesystem::rename(temp_path, snapshot_path, ec);
+    if (ec)
+    {
+        std::remove(temp_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * read a snapshot straight out of a mapping, the columns are used in place with no parsing
+ */
+bool read_cohort_snapshot(const string &snapshot_path, const csv_fingerprint &fingerprint, vector<student> &students, vector<team> *teams)
+{
+    mapped_file file;
+    if (!map_file(snapshot_path, file))
+    {
+        return false;
+    }
+
+    // check the header before trusting any of the columns
+    snapshot_header h;
+    bool ok = file.size >= sizeof(h);
+    if (ok)
+    {
+        std::memcpy(&h, file.data, sizeof(h));
+        ok = std::memcmp(h.magic, SNAPSHOT_MAGIC, sizeof(h.magic)) == 0 &&
+             h.version == SNAPSHOT_VERSION &&
+             h.byte_order == SNAPSHOT_BYTE_ORDER &&
+             h.csv_size == fingerprint.size &&
+             h.csv_mtime == fingerprint.mtime &&
+             h.csv_hash == fingerprint.hash &&
+             h.student_count < (1ULL << 31) &&
+             h.category_count <= MAX_CATEGORIES &&
+             h.availability_slots <= MAX_SLOTS &&
+             snapshot_size(h) == file.size;
+    }
+
+    if (!ok)
+    {
+        unmap_file(file);
+        return false;
+    }
+
+    uint64_t n = h.student_count;
+    const char *p = file.data + sizeof(h);
+
+    const uint8_t *skills = (const uint8_t *)p;
+    p += pad8(n * NUM_SKILLS);
+    const int32_t *scores = (const int32_t *)p;
+    p += pad8(n * 4);
+    // leader flags are derivable from leadership, so they are skipped on load
+    p += pad8(n);
+    const uint32_t *name_offsets = (const uint32_t *)p;
+    p += pad8((n + 1) * 4);
+    const char *names = p;
+    p += pad8(h.names_bytes);
+    const uint8_t *category_codes = (const uint8_t *)p;
+    p += pad8(h.category_count * n);
+    const uint8_t *value_counts = (const uint8_t *)p;
+    p += pad8(h.category_count);
+    const char *category_table = p;
+    const char *category_end = p + h.category_bytes;
+    p += pad8(h.category_bytes);
+    const uint64_t *availability = (h.availability_slots > 0) ? (const uint64_t *)p : nullptr;
+    p += (h.availability_slots > 0) ? n * 8 : 0;
+    const int32_t *team_of = (h.team_count > 0) ? (const int32_t *)p : nullptr;
+
+    // a damaged name table would send us outside the file
+    if (name_offsets[n] != h.names_bytes)
+    {
+        unmap_file(file);
+        return false;
+    }
+
+    // the category table back into columns, every string has to end inside the table
+    vector<category_column> categories(h.category_count);
+    vector<string> category_names;
+    const char *q = category_table;
+    for (int c = 0; c < categories.size(); c++)
+    {
+        for (int v = -1; v < value_counts[c]; v++)
+        {
+            const char *nul = (const char *)std::memchr(q, '\0', category_end - q);
+            if (nul == nullptr)
+            {
+                unmap_file(file);
+                return false;
+            }
+            if (v == -1)
+            {
+                categories[c].name.assign(q, nul);
+            }
+            else
+            {
+                categories[c].values.push_back(string(q, nul));
+            }
+            q = nul + 1;
+        }
+        category_names.push_back(categories[c].name);
+    }
+
+    vector<student> loaded(n);
+    for (uint64_t i = 0; i < n; i++)
+    {
+        student &s = loaded[i];
+        uint32_t from = name_offsets[i];
+        uint32_t to = name_offsets[i + 1];
+        if (from > to || to > h.names_bytes)
+        {
+            unmap_file(file);
+            return false;
+        }
+
+        s.name.assign(names + from, to - from);
+        s.leadership = skills[SKILL_LEADERSHIP * n + i];
+        s.frontend = skills[SKILL_FRONTEND * n + i];
+        s.backend = skills[SKILL_BACKEND * n + i];
+        s.security = skills[SKILL_SECURITY * n + i];
+        s.ui = skills[SKILL_UI * n + i];
+        s.english = skills[SKILL_ENGLISH * n + i];
+        s.student_score = scores[i];
+        // roles depend on the current rules, not on when the snapshot was written
+        s.roles = compute_role_mask(s);
+        for (int c = 0; c < categories.size(); c++)
+        {
+            s.category[c] = category_codes[c * n + i];
+        }
+        if (availability != nullptr)
+        {
+            s.availability = availability[i];
+        }
+        s.id = i;
+        s.x = 0.0;
+        s.y = 0.0;
+        s.selected = false;
+    }
+
+    // the stored codes join the active columns before any team counts them
+    use_category_columns(category_names);
+    merge_category_codes(loaded, 0, n, categories);
+    set_availability_slots(h.availability_slots);
+
+    // rebuild the teams from the stored assignment
+    if (teams != nullptr && team_of != nullptr)
+    {
+        vector<team> rebuilt(h.team_count);
+        for (int t = 0; t < rebuilt.size(); t++)
+        {
+            rebuilt[t].id = t + 1;
+        }
+
+        for (uint64_t i = 0; i < n; i++)
+        {
+            if (team_of[i] >= 0 && team_of[i] < rebuilt.size())
+            {
+                rebuilt[team_of[i]].members.push_back(loaded[i]);
+            }
+        }
+
+        for (int t = 0; t < rebuilt.size(); t++)
+        {
+            recompute_team_stats(rebuilt[t]);
+        }
+
+        teams->swap(rebuilt);
+    }
+
+    unmap_file(file);
+    students.swap(loaded);
+    return true;
+}
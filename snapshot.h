@@ -0,0 +1,48 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+
+using std::vector;
+using std::string;
+
+// bump this whenever the layout in snapshot.cpp changes, older snapshots are then ignored
+const uint32_t SNAPSHOT_VERSION = 3;
+
+// what a snapshot remembers about the csv it was built from
+struct csv_fingerprint
+{
+    uint64_t size;
+    int64_t mtime;
+    uint64_t hash;
+};
+
+// The snapshot file that belongs to a csv ("data.csv" -> "data.csv.snap").
+string snapshot_path_for(const string &csv_filename);
+
+// Hash a buffer (used to tell whether a csv changed even if its size and time did not).
+uint64_t hash_bytes(const char *data, size_t size);
+
+/**
+ * Fill a fingerprint from the csv's size, modification time and the hash of its contents.
+ *
+ * @param csv_filename the csv on disk
+ * @param data the csv contents (already mapped by the caller)
+ * @param size number of bytes in data
+ */
+bool fingerprint_csv(const string &csv_filename, const char *data, size_t size, csv_fingerprint &out);
+
+/**
+ * Write students (and optionally which team each one is in) to a binary snapshot.
+ * Written to a temporary file first so a crash never leaves half a snapshot behind.
+ */
+bool write_cohort_snapshot(const string &snapshot_path, const csv_fingerprint &fingerprint, const vector<student> &students, const vector<team> *teams);
+
+/**
+ * Read a snapshot if it was made from exactly this csv. Returns false (and leaves the outputs
+ * alone) when the snapshot is missing, stale, from another version or damaged.
+ * teams may be nullptr, otherwise it is filled if the snapshot holds an assignment.
+ */
+bool read_cohort_snapshot(const string &snapshot_path, const csv_fingerprint &fingerprint, vector<student> &students, vector<team> *teams);
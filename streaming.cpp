@@ -0,0 +1,443 @@
+// including relevant libraries
+#include "streaming.h"
+#include "io.h"
+#include "scoring.h"
+#include "exporter.h"
+#include "splashkit.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+
+using std::vector;
+using std::string;
+using std::to_string;
+
+/**
+ * sort order for the allocation: highest score first, earlier rows first on ties
+ */
+static bool record_before(const stream_record &a, const stream_record &b)
+{
+    if (a.score != b.score)
+    {
+        return a.score > b.score;
+    }
+    return a.row < b.row;
+}
+
+// a sorted run on disk, read back through a small buffer during the merge
+struct spill_run
+{
+    FILE *file = nullptr;
+    vector<stream_record> buffer;
+    size_t pos;
+    size_t count;
+    bool failed = false; // the run couldn't be opened or read back, its students would go missing
+};
+
+/**
+ * refill a run's buffer, returns false when the run is used up or can't be read (failed is set then)
+ */
+static bool refill_run(spill_run &run)
+{
+    run.count = std::fread(run.buffer.data(), sizeof(stream_record), run.buffer.size(), run.file);
+    run.pos = 0;
+    if (std::ferror(run.file))
+    {
+        run.failed = true;
+        return false;
+    }
+    return run.count > 0;
+}
+
+// the merge heap holds the current head of every run
+struct merge_entry
+{
+    stream_record record;
+    int run;
+};
+
+struct merge_order
+{
+    bool operator()(const merge_entry &a, const merge_entry &b) const
+    {
+        // priority_queue keeps the "largest" on top, so flip the order
+        return record_before(b.record, a.record);
+    }
+};
+
+// the team heap picks the same team choose_best_team_index would
+struct team_slot
+{
+    long long total;
+    int size;
+    int index;
+};
+
+struct team_order
+{
+    bool operator()(const team_slot &a, const team_slot &b) const
+    {
+        if (a.total != b.total)
+        {
+            return a.total > b.total;
+        }
+        if (a.size != b.size)
+        {
+            return a.size > b.size;
+        }
+        return a.index > b.index;
+    }
+};
+
+/**
+ * sort a full buffer and spill it to a new run file
+ */
+static bool spill_sorted_run(vector<stream_record> &records, const string &temp_dir, vector<string> &run_paths)
+{
+    std::sort(records.begin(), records.end(), record_before);
+
+    string path = temp_dir + "/stream_run_" + to_string(run_paths.size()) + ".bin";
+    FILE *f = std::fopen(path.c_str(), "wb");
+    if (f == nullptr)
+    {
+        write_line("Error: could not create spill file " + path);
+        return false;
+    }
+
+    size_t written = std::fwrite(records.data(), sizeof(stream_record), records.size(), f);
+    bool ok = (written == records.size());
+    std::fclose(f);
+    run_paths.push_back(path);
+    records.clear();
+
+    if (!ok)
+    {
+        write_line("Error: could not write spill file " + path);
+    }
+    return ok;
+}
+
+/**
+ * the streaming allocation (see streaming.h)
+ */
+bool stream_allocate_csv(const string &input_csv, const string &output_csv, int num_teams, size_t memory_budget_bytes, const string &temp_dir, vector<team_aggregate> &out_teams)
+{
+    out_teams.clear();
+
+    // must have at least one team
+    if (num_teams <= 0)
+    {
+        write_line("Number of teams must be > 0.");
+        return false;
+    }
+
+    // a quarter of the budget for parsing batches, the rest for the sort buffer
+    const size_t MIN_BUDGET = 1 << 20;
+    if (memory_budget_bytes < MIN_BUDGET)
+    {
+        memory_budget_bytes = MIN_BUDGET;
+    }
+    size_t batch_rows = memory_budget_bytes / 4 / (sizeof(student) + 16);
+    size_t sort_capacity = (memory_budget_bytes - memory_budget_bytes / 4) / sizeof(stream_record);
+
+    csv_row_reader reader;
+    if (!open_csv_rows(input_csv, reader))
+    {
+        return false;
+    }
+
+    // phase 1: read, score and cut into sorted runs
+    vector<stream_record> records;
+    records.reserve(sort_capacity);
+    vector<string> run_paths;
+    vector<student> batch;
+    const scoring_rubric &rubric = default_rubric();
+    bool ok = true;
+
+    while (ok && read_csv_rows(reader, batch_rows, batch))
+    {
+        for (int i = 0; i < batch.size(); i++)
+        {
+            stream_record r;
+            r.row = reader.rows_read - batch.size() + i;
+            r.score = compute_student_score_rubric(batch[i], rubric);
+            r.leader = batch[i].leadership >= LEADER_THRESHOLD;
+            records.push_back(r);
+
+            if (records.size() == sort_capacity)
+            {
+                ok = spill_sorted_run(records, temp_dir, run_paths);
+                if (!ok)
+                {
+                    break;
+                }
+            }
+        }
+    }
+    long long total_rows = reader.rows_read;
+    close_csv_rows(reader);
+    vector<student>().swap(batch);
+
+    // whatever is left either is the only run (no disk needed) or becomes the last run
+    if (ok && !run_paths.empty() && !records.empty())
+    {
+        ok = spill_sorted_run(records, temp_dir, run_paths);
+    }
+    else if (ok)
+    {
+        std::sort(records.begin(), records.end(), record_before);
+    }
+
+    // open the output
+    buffered_writer writer;
+    if (ok && !open_writer(writer, output_csv))
+    {
+        write_line("Error: could not create " + output_csv);
+        ok = false;
+    }
+
+    if (!ok)
+    {
+        for (int i = 0; i < run_paths.size(); i++)
+        {
+            std::remove(run_paths[i].c_str());
+        }
+        return false;
+    }
+
+    write_text(writer, "row,team\n");
+
+    // phase 2: merge the runs and place students as they come out, highest score first
+    out_teams.assign(num_teams, team_aggregate{0, 0, 0});
+    std::priority_queue<team_slot, vector<team_slot>, team_order> team_heap;
+    for (int t = 0; t < num_teams; t++)
+    {
+        team_heap.push(team_slot{0, 0, t});
+    }
+
+    // once everything is on disk the sort buffer is handed over to the merge buffers
+    vector<spill_run> runs(run_paths.size());
+    std::priority_queue<merge_entry, vector<merge_entry>, merge_order> merge_heap;
+    size_t per_run = std::max<size_t>(4096, sort_capacity / (runs.size() + 1));
+    if (!runs.empty())
+    {
+        vector<stream_record>().swap(records);
+    }
+
+    for (int i = 0; i < runs.size() && ok; i++)
+    {
+        runs[i].file = std::fopen(run_paths[i].c_str(), "rb");
+        runs[i].failed = (runs[i].file == nullptr);
+        runs[i].buffer.resize(per_run);
+        if (!runs[i].failed && refill_run(runs[i]))
+        {
+            merge_heap.push(merge_entry{runs[i].buffer[0], i});
+            runs[i].pos = 1;
+        }
+        if (runs[i].failed)
+        {
+            write_line("Error: could not read spill file " + run_paths[i]);
+            ok = false;
+        }
+    }
+
+    long long placed = 0;
+    size_t in_memory_pos = 0;
+    while (ok)
+    {
+        // next student in score order, either from memory or from the merge
+        stream_record next;
+        if (runs.empty())
+        {
+            if (in_memory_pos == records.size())
+            {
+                break;
+            }
+            next = records[in_memory_pos++];
+        }
+        else
+        {
+            if (merge_heap.empty())
+            {
+                break;
+            }
+
+            merge_entry top = merge_heap.top();
+            merge_heap.pop();
+            next = top.record;
+
+            spill_run &run = runs[top.run];
+            if (run.pos < run.count || refill_run(run))
+            {
+                merge_heap.push(merge_entry{run.buffer[run.pos], top.run});
+                run.pos++;
+            }
+            else if (run.failed)
+            {
+                write_line("Error: could not read spill file " + run_paths[top.run]);
+                ok = false;
+                break;
+            }
+        }
+
+        // pick best team and assign
+        team_slot slot = team_heap.top();
+        team_heap.pop();
+
+        team_aggregate &agg = out_teams[slot.index];
+        agg.total_score += next.score;
+        agg.size++;
+        agg.leaders += next.leader;
+
+        slot.total = agg.total_score;
+        slot.size = agg.size;
+        team_heap.push(slot);
+
+        // one "row,team" line per placement
+        write_int(writer, next.row);
+        write_text(writer, ",", 1);
+        write_int(writer, slot.index + 1);
+        write_text(writer, "\n", 1);
+        placed++;
+    }
+
+    bool write_ok = close_writer(writer);
+
+    // every row read has to come out of the merge, anything else means a run went missing
+    if (ok && placed != total_rows)
+    {
+        write_line("Error: placed " + to_string(placed) + " of " + to_string(total_rows) + " students.");
+        ok = false;
+    }
+
+    // clean up the spill files
+    for (int i = 0; i < runs.size(); i++)
+    {
+        if (runs[i].file != nullptr)
+        {
+            std::fclose(runs[i].file);
+        }
+        std::remove(run_paths[i].c_str());
+    }
+
+    // a partial allocation is worse than none, don't leave it behind
+    if (!ok)
+    {
+        std::remove(output_csv.c_str());
+        out_teams.clear();
+        return false;
+    }
+
+    write_line("Streamed " + to_string(total_rows) + " students into " + to_string(num_teams) + " teams (" + to_string(run_paths.size()) + " spill runs).");
+    return write_ok;
+}
+
+/**
+ * write a csv of random students in the usual layout
+ */
+bool write_synthetic_cohort_csv(const string &filename, long long count, unsigned seed)
+{
+    buffered_writer w;
+    if (!open_writer(w, filename))
+    {
+        write_line("Error: could not create " + filename);
+        return false;
+    }
+
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<int> skill(1, 10);
+
+    write_text(w, "Name,Leadership (1-10),Frontend (1-10),Backend (1-10),Security (1-10),UI/UX (1-10),English (1-10)\n");
+
+    for (long long i = 0; i < count; i++)
+    {
+        write_text(w, "Student", 7);
+        write_int(w, i + 1);
+
+        for (int s = 0; s < NUM_SKILLS; s++)
+        {
+            write_text(w, ",", 1);
+            write_int(w, skill(rng));
+        }
+        write_text(w, "\n", 1);
+    }
+
+    return close_writer(w);
+}
+
+/**
+ * read a whole positive number out of an argument, false if there is anything else in it
+ */
+static bool parse_count(const char *text, long long &out)
+{
+    char *end = nullptr;
+    out = std::strtoll(text, &end, 10);
+    return end != text && *end == '\0' && out > 0;
+}
+
+/**
+ * the command line batch mode (see streaming.h)
+ */
+int run_batch_command(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        return -1;
+    }
+    string command = argv[1];
+
+    if (command == "--synthetic")
+    {
+        long long count;
+        if (argc < 4 || !parse_count(argv[3], count))
+        {
+            write_line("Usage: --synthetic <file.csv> <count> [seed]");
+            return 1;
+        }
+        long long seed = 1;
+        if (argc > 4 && !parse_count(argv[4], seed))
+        {
+            write_line("Seed must be a positive number.");
+            return 1;
+        }
+        return write_synthetic_cohort_csv(argv[2], count, (unsigned)seed) ? 0 : 1;
+    }
+
+    if (command != "--stream")
+    {
+        return -1;
+    }
+
+    long long teams;
+    if (argc < 5 || !parse_count(argv[4], teams))
+    {
+        write_line("Usage: --stream <input.csv> <output.csv> <teams> [--memory-mb N] [--temp <dir>]");
+        return 1;
+    }
+
+    long long memory_mb = DEFAULT_STREAM_MEMORY_MB;
+    string temp_dir = ".";
+    for (int i = 5; i < argc; i++)
+    {
+        string flag = argv[i];
+        if (flag == "--memory-mb" && i + 1 < argc && parse_count(argv[i + 1], memory_mb))
+        {
+            i++;
+        }
+        else if (flag == "--temp" && i + 1 < argc)
+        {
+            temp_dir = argv[++i];
+        }
+        else
+        {
+            write_line("Unknown or incomplete option: " + flag);
+            return 1;
+        }
+    }
+
+    vector<team_aggregate> result;
+    bool ok = stream_allocate_csv(argv[2], argv[3], (int)teams, (size_t)memory_mb << 20, temp_dir, result);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,54 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include <vector>
+#include <string>
+#include <cstdint>
+#include <cstddef>
+
+using std::vector;
+using std::string;
+
+// memory budget of the --stream command when --memory-mb isn't given
+const long long DEFAULT_STREAM_MEMORY_MB = 256;
+
+// one student cut down to what the allocation needs (16 bytes, this is what gets sorted and spilled)
+struct stream_record
+{
+    int64_t row;   // row of the student in the input csv (0 = first data row)
+    int32_t score; // fixed point student_score
+    int32_t leader;
+};
+
+// running totals for one team, all the streaming allocator keeps per team
+struct team_aggregate
+{
+    long long total_score;
+    int size;
+    int leaders;
+};
+
+/**
+ * Allocate a cohort that doesn't fit in memory. Students are read from input_csv in batches,
+ * scored, sorted by score with an external merge sort (runs that don't fit in memory_budget_bytes
+ * are spilled to temp_dir) and then handed out like allocate_teams does: highest score first,
+ * to the team with the lowest total (smaller team, then lower index on ties).
+ * Each placement is written straight to output_csv as "row,team" (team numbers start at 1).
+ *
+ * @returns false if a file couldn't be read or written
+ */
+bool stream_allocate_csv(const string &input_csv, const string &output_csv, int num_teams, size_t memory_budget_bytes, const string &temp_dir, vector<team_aggregate> &out_teams);
+
+/**
+ * Write a synthetic cohort of count students with random 1-10 skills (for large scale simulations).
+ */
+bool write_synthetic_cohort_csv(const string &filename, long long count, unsigned seed);
+
+/**
+ * Batch mode for the command line, so huge cohorts never need the GUI:
+ *   --stream <input.csv> <output.csv> <teams> [--memory-mb N] [--temp <dir>]   runs stream_allocate_csv
+ *   --synthetic <file.csv> <count> [seed]                                       runs write_synthetic_cohort_csv
+ *
+ * @returns the exit code for main, or -1 when argv holds no batch command (start the GUI then)
+ */
+int run_batch_command(int argc, char *argv[]);
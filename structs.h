@@ -7,16 +7,37 @@
 // constant leader threshold (student must have a score of greater than or equal to 7 to be eligible to be a leader)
 const int LEADER_THRESHOLD = 7;
 
+// the six skills padded to 8 lanes, so per-skill team totals fill whole vector registers
+const int SKILL_LANES = 8;
+
+// most role rules a cohort can have (role 0 is always the leader rule, see roles.h)
+const int MAX_ROLES = 8;
+
+// most categorical columns a cohort can have (programme, campus, ...) and distinct values per column
+// (see categories.h, values past the limit share the last code)
+const int MAX_CATEGORIES = 4;
+const int MAX_CATEGORY_VALUES = 16;
+
+// weekly meeting slots an availability mask can hold (one bit per slot, e.g. 7 days x 9 hours)
+const int MAX_SLOTS = 64;
+
+// scores are fixed point integers in steps of 1/SCORE_SCALE points (x20 holds every current weight exactly)
+const int SCORE_SCALE = 20;
+
 // student struct
 struct student {
     std::string name;
+    int id; // row of the student in the loaded cohort
     int leadership;
     int frontend;
     int backend;
     int security;
     int ui;
     int english;
-    int student_score;
+    int student_score; // fixed point, see SCORE_SCALE
+    unsigned roles = 0; // bit r set if the student meets role rule r (filled in when scores are computed)
+    unsigned char category[MAX_CATEGORIES] = {0, 0, 0, 0}; // value code in each categorical column
+    unsigned long long availability = ~0ULL; // bit s set if free in slot s (no availability column = always free)
     // locations of where to place
     float x;
     float y;
@@ -27,8 +48,13 @@ struct student {
 struct team {
     std::vector<student> members;
     int size;            
-    int total_score;     
+    long long total_score; // fixed point sum of member scores
     bool hasLeader;      
+    int leaders;         // members at or above LEADER_THRESHOLD
+    int skill_totals[SKILL_LANES] = {0, 0, 0, 0, 0, 0, 0, 0}; // raw skill sums (lanes follow skill_index, 6 and 7 stay 0)
+    int role_counts[MAX_ROLES] = {0, 0, 0, 0, 0, 0, 0, 0};    // members meeting each role rule
+    int category_counts[MAX_CATEGORIES][MAX_CATEGORY_VALUES] = {}; // members with each value of each categorical column
+    int slot_counts[MAX_SLOTS] = {}; // members free in each slot
     int id;              
     // locations of where to place
     float x;
@@ -43,5 +69,5 @@ struct SwapSuggestion {
     int idxA;
     int teamB;
     int idxB;
-    double delta; // newchanges - old changes (negative = improvement) a way to keep track if its beneficial to swap or not
+    long long delta; // newchanges - old changes (negative = improvement) a way to keep track if its beneficial to swap or not
 };
\ No newline at end of file
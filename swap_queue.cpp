@@ -0,0 +1,219 @@
+// including relevant libraries
+#include "swap_queue.h"
+#include "allocator.h"
+#include <algorithm>
+
+using std::vector;
+
+/**
+ * heap order: true if x comes out after y (higher delta, then the later pair)
+ */
+static bool queued_after(const queued_swap &x, const queued_swap &y)
+{
+    if (x.swap.delta != y.swap.delta) return x.swap.delta > y.swap.delta;
+    if (x.swap.teamA != y.swap.teamA) return x.swap.teamA > y.swap.teamA;
+    return x.swap.teamB > y.swap.teamB;
+}
+
+/**
+ * search one pair and queue its best swap if it has an improving one
+ */
+static void queue_pair(swap_queue &q, const vector<team> &teams, int a, int b)
+{
+    if (a > b)
+    {
+        std::swap(a, b);
+    }
+    if (teams[a].members.empty() || teams[b].members.empty())
+    {
+        return;
+    }
+
+    total_extremes ext = {&q.highest, &q.lowest, q.total_sum};
+    int budget = teams[a].members.size() * teams[b].members.size();
+
+    queued_swap entry;
+    if (!best_pair_swap(teams, a, b, budget, q.cs, q.mode, extreme_mode(q.mode) ? &ext : nullptr, entry.swap))
+    {
+        return;
+    }
+    entry.version_a = q.version[a];
+    entry.version_b = q.version[b];
+    q.heap.push_back(entry);
+    std::push_heap(q.heap.begin(), q.heap.end(), queued_after);
+}
+
+/**
+ * the three highest and three lowest teams with their totals, what every pair's extreme term is measured against
+ */
+static void extreme_snapshot(const swap_queue &q, const vector<team> &teams, vector<long long> &out)
+{
+    out.clear();
+    const team_heap *heaps[2] = {&q.highest, &q.lowest};
+    for (int h = 0; h < 2; h++)
+    {
+        int first = heap_top(*heaps[h]);
+        int second = (first == -1) ? -1 : heap_best_excluding(*heaps[h], teams, first, first);
+        int third = (second == -1) ? -1 : heap_best_excluding(*heaps[h], teams, first, second);
+        int top[3] = {first, second, third};
+        for (int i = 0; i < 3; i++)
+        {
+            out.push_back(top[i]);
+            out.push_back(top[i] == -1 ? 0 : teams[top[i]].total_score);
+        }
+    }
+}
+
+/**
+ * true if neither team changed since the entry was queued
+ */
+static bool is_current(const swap_queue &q, const queued_swap &entry)
+{
+    return entry.version_a == q.version[entry.swap.teamA] && entry.version_b == q.version[entry.swap.teamB];
+}
+
+/**
+ * drop every stale entry once they could make up half the heap, so a long run doesn't keep them all
+ */
+static void sweep_stale(swap_queue &q, int team_count)
+{
+    if (q.heap.size() <= 2 * (size_t)q.settled_size + 2 * (size_t)team_count)
+    {
+        return;
+    }
+
+    int kept = 0;
+    for (int i = 0; i < q.heap.size(); i++)
+    {
+        if (is_current(q, q.heap[i]))
+        {
+            q.heap[kept++] = q.heap[i];
+        }
+    }
+    q.heap.resize(kept);
+    std::make_heap(q.heap.begin(), q.heap.end(), queued_after);
+    q.settled_size = kept;
+}
+
+/**
+ * queue every pair from scratch (the versions carry on, so nothing queued before is trusted)
+ */
+static void requeue_all(swap_queue &q, const vector<team> &teams)
+{
+    q.heap.clear();
+    for (int a = 0; a < teams.size(); a++)
+    {
+        for (int b = a + 1; b < teams.size(); b++)
+        {
+            queue_pair(q, teams, a, b);
+        }
+    }
+    q.settled_size = q.heap.size();
+}
+
+void begin_swap_queue(swap_queue &q, const vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    q.cs = cs;
+    q.mode = mode;
+    q.version.assign(teams.size(), 0);
+
+    // the extreme modes price every pair against the highest and lowest of the other teams
+    q.total_sum = 0;
+    heap_reset(q.highest, teams.size(), HEAP_HIGHEST_TOTAL);
+    heap_reset(q.lowest, teams.size(), HEAP_LOWEST_TOTAL);
+    for (int t = 0; t < teams.size(); t++)
+    {
+        heap_push(q.highest, teams, t);
+        heap_push(q.lowest, teams, t);
+        q.total_sum += teams[t].total_score;
+    }
+
+    requeue_all(q, teams);
+}
+
+bool swap_queue_top(swap_queue &q, SwapSuggestion &out)
+{
+    while (!q.heap.empty())
+    {
+        if (is_current(q, q.heap.front()))
+        {
+            out = q.heap.front().swap;
+            return true;
+        }
+
+        // one of its teams changed since, drop it
+        std::pop_heap(q.heap.begin(), q.heap.end(), queued_after);
+        q.heap.pop_back();
+    }
+    return false;
+}
+
+void apply_queued_swap(swap_queue &q, vector<team> &teams, const SwapSuggestion &s)
+{
+    int a = s.teamA;
+    int b = s.teamB;
+
+    vector<long long> before;
+    if (extreme_mode(q.mode))
+    {
+        extreme_snapshot(q, teams, before);
+    }
+
+    swap_members(teams[a], s.idxA, teams[b], s.idxB);
+    q.version[a]++;
+    q.version[b]++;
+    heap_update(q.highest, teams, a);
+    heap_update(q.highest, teams, b);
+    heap_update(q.lowest, teams, a);
+    heap_update(q.lowest, teams, b);
+
+    // the other teams' extremes moved, so every pair's delta did too
+    if (extreme_mode(q.mode))
+    {
+        vector<long long> after;
+        extreme_snapshot(q, teams, after);
+        if (after != before)
+        {
+            requeue_all(q, teams);
+            return;
+        }
+    }
+
+    // a swap only changes the totals, counts and masks of a and b, every other pair keeps its best swap
+    for (int t = 0; t < teams.size(); t++)
+    {
+        if (t != a)
+        {
+            queue_pair(q, teams, a, t);
+        }
+        if (t != a && t != b)
+        {
+            queue_pair(q, teams, b, t);
+        }
+    }
+    sweep_stale(q, teams.size());
+}
+
+int apply_best_swaps(swap_queue &q, vector<team> &teams, int max_swaps)
+{
+    int made = 0;
+    SwapSuggestion s;
+    while (made < max_swaps && swap_queue_top(q, s))
+    {
+        apply_queued_swap(q, teams, s);
+        made++;
+    }
+    return made;
+}
+
+int optimise_teams(vector<team> &teams, const constraint_store *cs, balance_mode mode)
+{
+    if (teams.size() < 2)
+    {
+        return 0;
+    }
+
+    swap_queue q;
+    begin_swap_queue(q, teams, cs, mode);
+    return apply_best_swaps(q, teams, OPTIMISE_SWAPS_PER_TEAM * (int)teams.size());
+}
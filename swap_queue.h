@@ -0,0 +1,68 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include "incremental.h"
+#include <vector>
+
+using std::vector;
+
+// swaps optimise_teams may make per team before it gives up (it stops sooner once no swap helps)
+const int OPTIMISE_SWAPS_PER_TEAM = 8;
+
+// the best swap of one team pair, and the versions both teams had when it was found
+struct queued_swap
+{
+    SwapSuggestion swap;
+    int version_a;
+    int version_b;
+};
+
+// Every team pair's best improving swap in a min-heap on delta. A swap bumps the version of the two teams
+// it changes and requeues only their pairs, older entries for them are dropped when they reach the top.
+struct swap_queue
+{
+    vector<queued_swap> heap;
+    vector<int> version;        // per team, bumped each time a swap changes it
+    const constraint_store *cs; // pins and apart rules every swap has to respect (nullptr = none)
+    balance_mode mode;
+    team_heap highest;          // extreme modes: every pair's delta reads the other teams' extremes
+    team_heap lowest;
+    long long total_sum;
+    int settled_size;           // heap size after the last rebuild or sweep of stale entries
+};
+
+/**
+ * Find the best improving swap of every team pair and queue it. O(k^2 * m log m).
+ */
+void begin_swap_queue(swap_queue &q, const vector<team> &teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * The best improving swap left, dropping entries whose teams changed since they were queued.
+ *
+ * @returns false if no swap lowers the balance metric
+ */
+bool swap_queue_top(swap_queue &q, SwapSuggestion &out);
+
+/**
+ * Make a swap (the top one or any other) and requeue the pairs of the two teams it changed, O(k * m log m).
+ * In the extreme modes the whole queue is rebuilt when the swap moves one of the three highest or lowest
+ * totals, those are what every other pair's delta is measured against.
+ */
+void apply_queued_swap(swap_queue &q, vector<team> &teams, const SwapSuggestion &s);
+
+/**
+ * Apply the top swap of the queue until none improves or max_swaps were made.
+ *
+ * @returns the number of swaps made
+ */
+int apply_best_swaps(swap_queue &q, vector<team> &teams, int max_swaps);
+
+/**
+ * Steepest descent over every team pair: build a queue and apply its best swap up to
+ * OPTIMISE_SWAPS_PER_TEAM times per team.
+ *
+ * @returns the number of swaps made
+ */
+int optimise_teams(vector<team> &teams, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
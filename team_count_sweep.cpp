@@ -0,0 +1,179 @@
+// including relevant libraries
+#include "team_count_sweep.h"
+#include "allocator.h"
+#include "incremental.h"
+#include "optimizer.h"
+#include "roles.h"
+#include "categories.h"
+#include "availability.h"
+#include "scoring.h"
+#include "splashkit.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <thread>
+
+using std::string;
+using std::to_string;
+using std::vector;
+
+/**
+ * run one k the way the Allocate button would: allocate, even out categories and slots, fix roles, settle, then measure
+ */
+static k_sweep_result evaluate_team_count(const vector<student> &students, const vector<int> &order, int k, const constraint_store *cs, balance_mode mode)
+{
+    vector<team> teams = allocate_teams_in_order(students, order, k, cs);
+    if (category_count() > 0)
+    {
+        balance_categories(teams, cs, mode);
+    }
+    if (availability_slots() > 0)
+    {
+        repair_availability(teams, cs, mode);
+    }
+    ensure_leader_present(teams, false, cs);
+    settle_teams(teams, k, cs, mode);
+
+    k_sweep_result r;
+    r.k = k;
+    r.metric = compute_balance_metric(teams, mode);
+    r.variance = metric_to_variance(team_spread_metric(teams), k);
+    r.min_size = teams[0].size;
+    r.max_size = teams[0].size;
+    r.teams_covered = 0;
+    unsigned required = required_roles();
+
+    long long total = 0;
+    for (int t = 0; t < teams.size(); t++)
+    {
+        r.min_size = std::min(r.min_size, teams[t].size);
+        r.max_size = std::max(r.max_size, teams[t].size);
+        r.teams_covered += ((required & ~team_coverage(teams[t])) == 0) ? 1 : 0;
+        total += teams[t].total_score;
+    }
+
+    // totals grow with team size, so compare the standard deviation relative to the mean team
+    double mean = (double)total / SCORE_SCALE / k;
+    r.spread = (mean > 0) ? std::sqrt(r.variance) / mean : 0.0;
+    r.metric_spread = (mean > 0) ? std::sqrt(metric_to_variance(r.metric, k)) / mean : 0.0;
+    return r;
+}
+
+/**
+ * allocate for a range of team counts in parallel (see team_count_sweep.h)
+ */
+vector<k_sweep_result> sweep_team_counts(const vector<student> &students, int k_min, int k_max, int num_threads, const constraint_store *cs, balance_mode mode)
+{
+    vector<k_sweep_result> results;
+
+    if (k_min < 1)
+    {
+        k_min = 1;
+    }
+    if (k_max > (int)students.size())
+    {
+        k_max = students.size();
+    }
+    if (students.empty() || k_min > k_max)
+    {
+        write_line("Nothing to sweep: need students and a range of team counts.");
+        return results;
+    }
+
+    results.resize(k_max - k_min + 1);
+
+    // one sort serves every k
+    vector<int> order = order_by_score(students);
+
+    if (num_threads <= 0)
+    {
+        num_threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    if (num_threads > results.size())
+    {
+        num_threads = results.size();
+    }
+
+    // bigger k costs more to settle, so threads take the next k as they finish rather than a fixed slice
+    std::atomic<int> next(0);
+    auto worker = [&]()
+    {
+        int i;
+        while ((i = next.fetch_add(1)) < results.size())
+        {
+            results[i] = evaluate_team_count(students, order, k_min + i, cs, mode);
+        }
+    };
+
+    vector<std::thread> workers;
+    for (int t = 1; t < num_threads; t++)
+    {
+        workers.push_back(std::thread(worker));
+    }
+    worker();
+
+    for (int t = 0; t < workers.size(); t++)
+    {
+        workers[t].join();
+    }
+
+    return results;
+}
+
+/**
+ * pick the recommended k (see team_count_sweep.h)
+ */
+int best_sweep_result(const vector<k_sweep_result> &results)
+{
+    int best = -1;
+
+    for (int i = 0; i < results.size(); i++)
+    {
+        const k_sweep_result &r = results[i];
+        if (best == -1)
+        {
+            best = i;
+            continue;
+        }
+
+        const k_sweep_result &b = results[best];
+        bool covered = (r.teams_covered == r.k);
+        bool best_covered = (b.teams_covered == b.k);
+
+        if (covered != best_covered)
+        {
+            if (covered)
+            {
+                best = i;
+            }
+            continue;
+        }
+
+        if (r.metric_spread < b.metric_spread || (r.metric_spread == b.metric_spread && r.max_size - r.min_size < b.max_size - b.min_size))
+        {
+            best = i;
+        }
+    }
+
+    return best;
+}
+
+/**
+ * print one line per k
+ */
+void print_sweep_results(const vector<k_sweep_result> &results, int best)
+{
+    write_line("k | variance | spread | sizes | teams covering every role");
+
+    for (int i = 0; i < results.size(); i++)
+    {
+        const k_sweep_result &r = results[i];
+        string line = to_string(r.k) + " | " + to_string(r.variance) + " | " + to_string(r.spread) + " | " + to_string(r.min_size) + "-" + to_string(r.max_size) + " | " + to_string(r.teams_covered) + "/" + to_string(r.k);
+
+        if (i == best)
+        {
+            line += "  <- recommended";
+        }
+        write_line(line);
+    }
+}
@@ -0,0 +1,40 @@
+// including relevant libraries
+#pragma once
+#include "structs.h"
+#include "constraints.h"
+#include "optimizer.h"
+#include <vector>
+
+using std::vector;
+
+// how one team count came out after allocation, role fix and a short optimisation
+struct k_sweep_result
+{
+    int k;
+    long long metric;   // compute_balance_metric of the final teams (in the sweep's balance mode)
+    double variance;    // variance of team totals alone, no penalties (display units)
+    double spread;      // standard deviation of totals over the mean total, comparable across k
+    double metric_spread; // the same from the full metric, penalties and all (what picks k)
+    int min_size;
+    int max_size;
+    int teams_covered;  // teams covering every role
+};
+
+/**
+ * Allocate for every k in [k_min, k_max] across num_threads threads (<= 0 uses every core).
+ * The cohort, its score order and cs are shared read-only by all threads, only the teams are per k.
+ *
+ * @returns one result per k, in k order
+ */
+vector<k_sweep_result> sweep_team_counts(const vector<student> &students, int k_min, int k_max, int num_threads, const constraint_store *cs = nullptr, balance_mode mode = BALANCE_TOTAL);
+
+/**
+ * Index of the recommended result: full role coverage first, then the lowest metric_spread,
+ * then the smallest size difference. -1 if results is empty.
+ */
+int best_sweep_result(const vector<k_sweep_result> &results);
+
+/**
+ * Print the sweep as a table, marking the recommended k.
+ */
+void print_sweep_results(const vector<k_sweep_result> &results, int best);
@@ -9,8 +9,20 @@
 #include "utilities.h"
 #include <sstream>
 #include "optimizer.h"
+#include "exporter.h"
+#include "cohort_sync.h"
+#include "incremental.h"
+#include "team_count_sweep.h"
+#include "roles.h"
+#include "rotation.h"
+#include "partition.h"
+#include "categories.h"
+#include "availability.h"
+#include "swap_queue.h"
+#include "snapshot.h"
 
 #include <string>
+#include <algorithm>
 
 using std::string;
 using std::vector;
@@ -28,6 +40,15 @@ void ui_init(UIContext &ctx)
     ctx.buttons.clear();
     ctx.running = true;
     ctx.suggestions_locked = false;
+    ctx.queue_ready = false;
+    ctx.cohort = cohort_index();
+    ctx.loaded_csv = "";
+    ctx.watcher.active = false;
+    ctx.watcher.inotify_fd = -1;
+    ctx.constraints = constraint_store();
+    ctx.preferences = preference_store();
+    build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
+    ctx.balance = BALANCE_TOTAL;
 
     // the size of window is needed to ensure the button layout size. I will be going for 1280x720
     layout_buttons(ctx, 1280.0, 720.0);
@@ -38,6 +59,17 @@ void ui_init(UIContext &ctx)
  */
 void ui_cleanup(UIContext &ctx)
 {
+    // the teams go into the csv's snapshot so loading the same file next time brings them back
+    // (not if the file changed after the last reload, the rows wouldn't match it any more)
+    if (!ctx.loaded_csv.empty() && !ctx.teams.empty() && !file_changed(ctx.watcher))
+    {
+        if (save_allocation_snapshot(ctx.loaded_csv, ctx.students, ctx.teams))
+        {
+            write_line("Saved the teams with " + snapshot_path_for(ctx.loaded_csv) + ".");
+        }
+    }
+
+    stop_watching(ctx.watcher);
     ctx.buttons.clear();
     ctx.running = false;
 }
@@ -102,6 +134,9 @@ void ui_run(UIContext &ctx)
     // initialize inputs
     ctx.reading_csv = false;
     ctx.reading_teams = false;
+    ctx.reading_withdraw = false;
+    ctx.reading_team_count = false;
+    ctx.reading_rotation = false;
     ctx.input_rect = rectangle_from(230.0, 50.0, 300.0, 30.0);
     ctx.current_input = "";
     ctx.status_message = "";
@@ -144,8 +179,62 @@ void ui_run(UIContext &ctx)
         ctx.scroll_offset_y = fmax(0, ctx.scroll_offset_y);
         ctx.scroll_offset_y = fmin(ctx.max_scroll_y, ctx.scroll_offset_y);
 
+        // live reload, the csv changed on disk so merge the changes into the current teams
+        if (file_changed(ctx.watcher))
+        {
+            // with teams the reload is diffed against the students already scored, so the snapshot and scoring are skipped
+            int grid_before = availability_slots();
+            std::vector<student> fresh = load_students_from_csv(ctx.loaded_csv, 0, !ctx.teams.empty());
+
+            if (fresh.empty())
+            {
+                ctx.status_message = "Reload skipped: " + ctx.loaded_csv + " has no students right now.";
+            }
+
+            else if (ctx.teams.empty())
+            {
+                ctx.students = fresh;
+                ctx.cohort = cohort_index();
+                resolve_constraints(ctx.constraints, ctx.students);
+                build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
+                ctx.status_message = "Reloaded " + std::to_string(ctx.students.size()) + " students from " + ctx.loaded_csv;
+            }
+
+            else
+            {
+                // slot counts only cover the grid, so a reload that changed its width has them recounted first
+                if (availability_slots() != grid_before)
+                {
+                    for (int t = 0; t < ctx.teams.size(); t++)
+                    {
+                        recompute_team_stats(ctx.teams[t]);
+                    }
+                }
+
+                // the constraints follow the rows inside, the preferences only need resolving again if ids moved
+                cohort_diff_summary d = apply_cohort_changes(ctx.students, ctx.teams, fresh, ctx.cohort, &ctx.constraints, ctx.balance);
+                if (d.ids_moved)
+                {
+                    build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
+                    for (int i = 0; ctx.cohort.withdrawn_count > 0 && i < ctx.cohort.withdrawn.size(); i++)
+                    {
+                        if (ctx.cohort.withdrawn[i])
+                        {
+                            drop_graph_vertex(ctx.preference_links, i);
+                        }
+                    }
+                }
+
+                // old suggestions point at members that may have moved
+                ctx.suggestions.clear();
+                ctx.suggestions_locked = false;
+                ctx.queue_ready = false;
+                ctx.status_message = "Reloaded " + ctx.loaded_csv + ": " + std::to_string(d.added) + " added, " + std::to_string(d.removed) + " removed, " + std::to_string(d.edited) + " edited.";
+            }
+        }
+
         // handle inputs for csv and teams
-        if (ctx.reading_csv || ctx.reading_teams)
+        if (ctx.reading_csv || ctx.reading_teams || ctx.reading_withdraw || ctx.reading_team_count || ctx.reading_rotation)
         {
         }
         if (!reading_text())
@@ -172,8 +261,9 @@ void ui_run(UIContext &ctx)
                         name = "sample_data.csv";
                     }
 
-                    // load students from csv
-                    std::vector<student> loaded = load_students_from_csv(name);
+                    // load students from csv (and the teams saved with its snapshot, if there are any)
+                    std::vector<team> saved;
+                    std::vector<student> loaded = load_students_from_csv(name, 0, false, &saved);
 
                     // error handling for if no students were loaded
                     if (loaded.empty())
@@ -185,11 +275,61 @@ void ui_run(UIContext &ctx)
                     else
                     {
                         ctx.students = loaded;
+                        ctx.cohort = cohort_index();
                         ctx.suggestions_locked = false;
 
                         ctx.teams.clear();
                         ctx.status_message = ("Loaded " + std::to_string(ctx.students.size()) + " students from " + name);
                         write_line(ctx.status_message);
+
+                        // keep an eye on the file so edits show up without reloading by hand
+                        ctx.loaded_csv = name;
+                        start_watching(ctx.watcher, name);
+
+                        // the extra roles every team should cover (backend, security...) live next to the csv, without them just a leader
+                        set_extra_role_rules(vector<role_rule>());
+                        if (load_role_rules_csv(roles_path_for(name)))
+                        {
+                            ctx.status_message += " (with roles)";
+                        }
+                        assign_roles(ctx.students);
+
+                        // pins and apart rules live next to the csv, if there are any
+                        ctx.constraints = constraint_store();
+                        if (load_constraints_csv(constraints_path_for(name), ctx.constraints))
+                        {
+                            resolve_constraints(ctx.constraints, ctx.students);
+                            ctx.status_message += " (with constraints)";
+                        }
+
+                        // so do the want / avoid preferences, which switch Allocate to the partitioner
+                        ctx.preferences = preference_store();
+                        if (load_preferences_csv(preferences_path_for(name), ctx.preferences))
+                        {
+                            ctx.status_message += " (with preferences)";
+                        }
+                        build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
+
+                        // saved teams come back with the roles just assigned, rows in no team were withdrawn
+                        if (!saved.empty())
+                        {
+                            ctx.cohort.withdrawn.assign(ctx.students.size(), true);
+                            ctx.cohort.withdrawn_count = ctx.students.size();
+                            for (int t = 0; t < saved.size(); t++)
+                            {
+                                for (int m = 0; m < saved[t].members.size(); m++)
+                                {
+                                    int id = saved[t].members[m].id;
+                                    saved[t].members[m].roles = ctx.students[id].roles;
+                                    ctx.cohort.withdrawn[id] = false;
+                                    ctx.cohort.withdrawn_count--;
+                                }
+                                recompute_team_stats(saved[t]);
+                            }
+                            ctx.teams.swap(saved);
+                            limit_pins_to_teams(ctx.constraints, ctx.teams.size());
+                            ctx.status_message += " (with the saved teams)";
+                        }
                     }
 
                     ctx.reading_csv = false;
@@ -198,16 +338,26 @@ void ui_run(UIContext &ctx)
                 // teams input handling
                 else if (ctx.reading_teams)
                 {
-                    int numTeams = 0;
-
-                    // using catch as i learnt in the programmers.guide to avoid crashes
-                    try
+                    // withdrawn rows are dropped for good before the whole cohort is allocated again
+                    if (compact_withdrawn(ctx.students, ctx.teams, ctx.cohort))
                     {
-                        numTeams = std::stoi(input);
+                        resolve_constraints(ctx.constraints, ctx.students);
+                        build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
                     }
-                    catch (...)
+
+                    // same non-throwing number parser the CSV loader uses (0 if it isn't a number)
+                    int numTeams = safe_stoi(input, 0);
+
+                    // "a-b" is auto k: try every team count in the range and use the recommended one
+                    size_t dash = input.find('-');
+                    bool auto_k = (dash != std::string::npos && dash > 0);
+                    int k_min = 0;
+                    int k_max = 0;
+                    if (auto_k)
                     {
-                        numTeams = 0;
+                        k_min = safe_stoi(input.substr(0, dash), 0);
+                        k_max = safe_stoi(input.substr(dash + 1), 0);
+                        numTeams = (k_min > 0 && k_max >= k_min) ? k_min : 0;
                     }
 
                     // error handling if invalid input
@@ -242,23 +392,148 @@ void ui_run(UIContext &ctx)
                             ctx.status_message = "Scores computed before team allocation.";
                         }
 
-                        // making the teams!
-                        ctx.teams = allocate_teams(ctx.students, numTeams);
+                        // a pin past the last team can't be honoured, drop it now rather than have each engine guess
+                        // (auto k drops pins past the smallest k tried, so every k in the sweep sees the same rules)
+                        limit_pins_to_teams(ctx.constraints, numTeams);
 
-                        ensure_leader_present(ctx.teams);
+                        std::string sweep_note = "";
+                        if (auto_k)
+                        {
+                            // every k runs on its own core, the console gets the full table
+                            vector<k_sweep_result> results = sweep_team_counts(ctx.students, k_min, k_max, 0, &ctx.constraints, ctx.balance);
+                            int best = best_sweep_result(results);
+                            print_sweep_results(results, best);
+
+                            if (best != -1)
+                            {
+                                numTeams = results[best].k;
+                                sweep_note = " (best of " + std::to_string(k_min) + "-" + std::to_string(k_max) + ", see console)";
+                            }
+                        }
+
+                        // making the teams! with preferences the partitioner keeps friends together within the balance limits
+                        if (!ctx.preference_links.adj.empty())
+                        {
+                            ctx.teams = allocate_teams_partitioned(ctx.students, ctx.preference_links, numTeams, &ctx.constraints);
+                        }
+                        else
+                        {
+                            ctx.teams = allocate_teams(ctx.students, numTeams, &ctx.constraints, ctx.balance);
+                        }
+
+                        ensure_leader_present(ctx.teams, true, &ctx.constraints);
+                        ctx.cohort.ready = false;
+
+                        // auto k measured the teams after a short optimisation, so do the same here
+                        // (not over partitioned teams, the swaps would split friends up again)
+                        if (auto_k && ctx.preference_links.adj.empty())
+                        {
+                            settle_teams(ctx.teams, ctx.teams.size(), &ctx.constraints, ctx.balance);
+                        }
 
                         ctx.suggestions_locked = false;
 
-                        ctx.status_message = "Allocated " + std::to_string(numTeams) + " teams successfully.";
+                        ctx.status_message = "Allocated " + std::to_string(numTeams) + " teams successfully." + sweep_note;
                     }
 
                     ctx.reading_teams = false;
                 }
+
+                // withdrawn student input handling
+                else if (ctx.reading_withdraw)
+                {
+                    int gone = withdraw_student(ctx.students, ctx.teams, ctx.cohort, input, &ctx.constraints, ctx.balance);
+                    if (gone != -1)
+                    {
+                        // the row stays as a tombstone so no id moves, only the student's own preferences go
+                        drop_graph_vertex(ctx.preference_links, gone);
+
+                        // suggestions point at member slots that may have moved
+                        ctx.suggestions.clear();
+                        ctx.status_message = "Withdrew " + input + " and rebalanced their team.";
+                    }
+                    else
+                    {
+                        ctx.status_message = "No student named " + input + " is in a team.";
+                    }
+
+                    ctx.reading_withdraw = false;
+                }
+
+                // new team count input handling (teams are split or merged in place)
+                else if (ctx.reading_team_count)
+                {
+                    int numTeams = safe_stoi(input, 0);
+
+                    if (numTeams <= 0)
+                    {
+                        ctx.status_message = ("Invalid number of teams: " + input + "");
+                    }
+
+                    else
+                    {
+                        set_team_count(ctx.teams, numTeams, DEFAULT_REPAIR_BUDGET, &ctx.constraints, ctx.balance);
+                        ctx.cohort.ready = false;
+                        ctx.suggestions.clear();
+                        ctx.status_message = "Now " + std::to_string(ctx.teams.size()) + " teams, most students kept their team.";
+                    }
+
+                    ctx.reading_team_count = false;
+                }
+
+                // rotation input handling: that many rounds at the current team count
+                else if (ctx.reading_rotation)
+                {
+                    int rounds = safe_stoi(input, 0);
+
+                    if (rounds <= 0)
+                    {
+                        ctx.status_message = ("Invalid number of rounds: " + input + "");
+                    }
+
+                    else
+                    {
+                        if (compact_withdrawn(ctx.students, ctx.teams, ctx.cohort))
+                        {
+                            resolve_constraints(ctx.constraints, ctx.students, ctx.teams.size());
+                            build_preference_graph(ctx.preferences, ctx.students, ctx.preference_links);
+                        }
+
+                        vector<rotation_round> schedule = schedule_rotations(ctx.students, ctx.teams.size(), rounds, DEFAULT_REPEAT_PENALTY, 0, &ctx.constraints, ctx.balance);
+                        print_rotation_summary(schedule);
+
+                        // every round goes to its own csv, the first one is shown
+                        bool export_ok = true;
+                        for (int r = 0; r < schedule.size(); r++)
+                        {
+                            export_ok = export_teams_csv("rotation_round_" + std::to_string(r + 1) + ".csv", schedule[r].teams) && export_ok;
+                        }
+
+                        if (!schedule.empty())
+                        {
+                            ctx.teams = schedule[0].teams;
+                            ctx.cohort.ready = false;
+                            ctx.suggestions.clear();
+                            ctx.suggestions_locked = false;
+                        }
+
+                        if (export_ok)
+                        {
+                            ctx.status_message = "Wrote " + std::to_string(schedule.size()) + " rounds to rotation_round_N.csv, showing round 1.";
+                        }
+                        else
+                        {
+                            ctx.status_message = "Rotation export failed, check the console for details.";
+                        }
+                    }
+
+                    ctx.reading_rotation = false;
+                }
             }
         }
 
         // when mouse clicked
-        if (!ctx.reading_csv && !ctx.reading_teams && mouse_clicked(LEFT_BUTTON))
+        if (!ctx.reading_csv && !ctx.reading_teams && !ctx.reading_withdraw && !ctx.reading_team_count && !ctx.reading_rotation && mouse_clicked(LEFT_BUTTON))
         {
             // position of mouse
             float mx = mouse_x();
@@ -291,10 +566,16 @@ void ui_run(UIContext &ctx)
                 // check what the label is on the button for running the relavent command
                 std::string label = ctx.buttons[clicked_idx].label;
 
+                // the swap queue only follows its own swaps, every other button may change the teams under it
+                if (label != "Apply Top" && label != "Optimise")
+                {
+                    ctx.queue_ready = false;
+                }
+
                 // if user clicked on load csv
                 if (label == "Load CSV")
                 {
-                    ctx.input_rect = rectangle_from(12.0, 492.0, 180.0, 36.0);
+                    ctx.input_rect = rectangle_from(12.0, 650.0, 180.0, 36.0);
                     ctx.current_input.clear();
 
                     // initalize the box for typing
@@ -333,13 +614,13 @@ void ui_run(UIContext &ctx)
 
                     else
                     {
-                        ctx.input_rect = rectangle_from(12.0, 492.0, 180.0, 36.0);
+                        ctx.input_rect = rectangle_from(12.0, 650.0, 180.0, 36.0);
                         ctx.current_input.clear();
                         
                         // open textbox
                         start_reading_text(ctx.input_rect);
                         ctx.reading_teams = true;
-                        ctx.status_message = ("Type number of teams and press Enter.");
+                        ctx.status_message = ("Type number of teams (or a range like 4-12 to find the best) and press Enter.");
                     }
                 }
 
@@ -354,33 +635,40 @@ void ui_run(UIContext &ctx)
 
                     else
                     {
-                        // ensure every team has a leader
-                        ensure_leader_present(ctx.teams);
+                        // ensure every team covers every role (a leader, plus any from the csv's roles sidecar)
+                        ensure_leader_present(ctx.teams, true, &ctx.constraints);
+                        ctx.cohort.ready = false;
                         ctx.suggestions_locked = false;
 
-                        // check if every team still doesn't have a leader
+                        // check if some team still misses a role
 
-                        bool anyMissingLeader = false;
+                        bool anyMissingRole = false;
+                        unsigned required = required_roles();
 
                         for (int i = 0; i < ctx.teams.size(); i++)
                         {
-                            if (!ctx.teams[i].hasLeader)
+                            if (required & ~team_coverage(ctx.teams[i]))
                             {
-                                anyMissingLeader = true;
+                                anyMissingRole = true;
                                 break;
                             }
                         }
 
-                        if (anyMissingLeader)
+                        if (anyMissingRole)
                         {
-                            ctx.status_message = "WARNING: not all teams have leaders due to unavailability of leaders.";
+                            ctx.status_message = "WARNING: not all teams cover every role due to unavailability of students.";
                         }
 
-                        else
+                        else if (role_rules().size() == 1)
                         {
                             ctx.status_message = "All teams have leaders.";
                         }
 
+                        else
+                        {
+                            ctx.status_message = "All teams cover every role.";
+                        }
+
                         // just as a safe check to output to the cli (maybe for debugging :D)
                         write_line(ctx.status_message);
                     }
@@ -403,7 +691,7 @@ void ui_run(UIContext &ctx)
 
                     else
                     {
-                        generate_swap_suggestions(ctx.teams, MAX_SUGGS, ctx.suggestions);
+                        generate_swap_suggestions(ctx.teams, MAX_SUGGS, ctx.suggestions, &ctx.constraints, ctx.balance);
 
                         if (ctx.suggestions.empty())
                         {
@@ -420,40 +708,203 @@ void ui_run(UIContext &ctx)
                 // button for apply top (apply advanced algorithm suggestions)
                 else if (label == "Apply Top")
                 {
-                    if (ctx.suggestions.empty())
+                    if (ctx.suggestions.empty() && !ctx.queue_ready)
                     {
                         ctx.status_message = ("No suggestions available. Click Suggest first.");
                     }
 
                     else
                     {
-                        int idx = ctx.chosenSuggestionIndex;
+                        // the queue keeps every team pair's best swap, so pressing again only searches the pairs of the two teams that changed
+                        if (!ctx.queue_ready)
+                        {
+                            begin_swap_queue(ctx.queue, ctx.teams, &ctx.constraints, ctx.balance);
+                            ctx.queue_ready = true;
+                        }
+
+                        SwapSuggestion s;
+                        bool found = true;
+
+                        // the suggestion picked on screen goes first, after that the best swap left
+                        if (!ctx.suggestions.empty())
+                        {
+                            int idx = ctx.chosenSuggestionIndex;
+
+                            // crash/error handling againa
+                            if (idx < 0 || idx >= ctx.suggestions.size())
+                            {
+                                idx = 0;
+                            }
 
-                        // crash/error handling againa
-                        if (idx < 0 || idx >= ctx.suggestions.size())
+                            s = ctx.suggestions[idx];
+                        }
+                        else
                         {
-                            idx = 0;
+                            found = swap_queue_top(ctx.queue, s);
                         }
 
-                        SwapSuggestion s = ctx.suggestions[idx];
+                        ctx.suggestions.clear();
 
+                        if (!found)
+                        {
+                            ctx.status_message = "No swap improves the balance any more.";
+                        }
 
-                        // Do the actual swap now:
-                        student temp = ctx.teams[s.teamA].members[s.idxA];
+                        else
+                        {
+                            // Do the actual swap now (stats of both teams are updated, the queue requeues their pairs)
+                            apply_queued_swap(ctx.queue, ctx.teams, s);
+                            refresh_cohort_team(ctx.cohort, ctx.teams, s.teamA);
+                            refresh_cohort_team(ctx.cohort, ctx.teams, s.teamB);
+
+                            // prevent new suggestions until teams are reassigned
+                            ctx.suggestions_locked = true;
+                            ctx.status_message = ("Applied suggestion: swapped member from Team " + std::to_string(s.teamA + 1) + " with Team " + std::to_string(s.teamB + 1) + ". Apply Top again for the next best swap.");
+                        }
+                    }
+                }
 
-                        ctx.teams[s.teamA].members[s.idxA] = ctx.teams[s.teamB].members[s.idxB];
+                // button for optimising all teams at once, the best swap over every team pair until none helps
+                else if (label == "Optimise")
+                {
+                    if (ctx.teams.size() < 2)
+                    {
+                        ctx.status_message = "Allocate at least two teams first.";
+                    }
 
-                        ctx.teams[s.teamB].members[s.idxB] = temp;
+                    else
+                    {
+                        if (!ctx.queue_ready)
+                        {
+                            begin_swap_queue(ctx.queue, ctx.teams, &ctx.constraints, ctx.balance);
+                            ctx.queue_ready = true;
+                        }
 
-                        // recompute affected team stats
-                        recompute_team_stats(ctx.teams[s.teamA]);
-                        recompute_team_stats(ctx.teams[s.teamB]);
+                        long long before = compute_balance_metric(ctx.teams, ctx.balance);
+                        int made = apply_best_swaps(ctx.queue, ctx.teams, OPTIMISE_SWAPS_PER_TEAM * ctx.teams.size());
+                        ctx.cohort.ready = false;
+                        long long after = compute_balance_metric(ctx.teams, ctx.balance);
 
+                        // old suggestions point at members that may have moved
                         ctx.suggestions.clear();
-                        
-                        // prevent new suggestions until teams are reassigned
-                        ctx.suggestions_locked = true;
-                        ctx.status_message = ("Applied suggestion: swapped member from Team " + std::to_string(s.teamA + 1) + " with Team " + std::to_string(s.teamB + 1) + ".");
+                        ctx.status_message = "Optimised with " + std::to_string(made) + " swaps, variance " + std::to_string(metric_to_variance(before, ctx.teams.size())) + " -> " + std::to_string(metric_to_variance(after, ctx.teams.size())) + ".";
+                        write_line(ctx.status_message);
+                    }
+                }
+
+                // button for withdrawing a student who dropped out
+                else if (label == "Withdraw")
+                {
+                    if (ctx.teams.empty())
+                    {
+                        ctx.status_message = "Allocate teams first.";
+                    }
+
+                    else
+                    {
+                        ctx.input_rect = rectangle_from(12.0, 650.0, 180.0, 36.0);
+                        ctx.current_input.clear();
+
+                        // open textbox
+                        start_reading_text(ctx.input_rect);
+                        ctx.reading_withdraw = true;
+                        ctx.status_message = ("Type the name of the student who withdrew and press Enter.");
+                    }
+                }
+
+                // button for trying a different number of teams without reallocating
+                else if (label == "Team Count")
+                {
+                    if (ctx.teams.empty())
+                    {
+                        ctx.status_message = "Allocate teams first.";
+                    }
+
+                    else
+                    {
+                        ctx.input_rect = rectangle_from(12.0, 650.0, 180.0, 36.0);
+                        ctx.current_input.clear();
+
+                        // open textbox
+                        start_reading_text(ctx.input_rect);
+                        ctx.reading_team_count = true;
+                        ctx.status_message = ("Type the new number of teams and press Enter.");
+                    }
+                }
+
+                // button for planning several rounds of teams with as few repeat teammates as possible
+                else if (label == "Rotation")
+                {
+                    if (ctx.teams.empty())
+                    {
+                        ctx.status_message = "Allocate teams first, the rotation keeps that number of teams.";
+                    }
+
+                    else
+                    {
+                        ctx.input_rect = rectangle_from(12.0, 650.0, 180.0, 36.0);
+                        ctx.current_input.clear();
+
+                        // open textbox
+                        start_reading_text(ctx.input_rect);
+                        ctx.reading_rotation = true;
+                        ctx.status_message = ("Type the number of rounds and press Enter.");
+                    }
+                }
+
+                // button for cycling what gets balanced: totals, every skill, the range or the worst deviation
+                else if (label.rfind("Balance: ", 0) == 0)
+                {
+                    if (ctx.balance == BALANCE_TOTAL)
+                    {
+                        ctx.balance = BALANCE_SKILLS;
+                        ctx.buttons[clicked_idx].label = "Balance: Skills";
+                        ctx.status_message = "Suggestions now balance each skill across teams.";
+                    }
+                    else if (ctx.balance == BALANCE_SKILLS)
+                    {
+                        ctx.balance = BALANCE_RANGE;
+                        ctx.buttons[clicked_idx].label = "Balance: Range";
+                        ctx.status_message = "Suggestions now close the gap between the highest and lowest team.";
+                    }
+                    else if (ctx.balance == BALANCE_RANGE)
+                    {
+                        ctx.balance = BALANCE_MAX_DEVIATION;
+                        ctx.buttons[clicked_idx].label = "Balance: Max dev";
+                        ctx.status_message = "Suggestions now pull in the team furthest from the average.";
+                    }
+                    else
+                    {
+                        ctx.balance = BALANCE_TOTAL;
+                        ctx.buttons[clicked_idx].label = "Balance: Total";
+                        ctx.status_message = "Suggestions now balance team totals.";
+                    }
+
+                    // the old suggestions were ranked for the other mode
+                    ctx.suggestions.clear();
+                }
+
+                // button for exporting the teams to csv and json
+                else if (label == "Export")
+                {
+                    if (ctx.teams.empty())
+                    {
+                        ctx.status_message = "Allocate teams first.";
+                    }
+
+                    else
+                    {
+                        bool csv_ok = export_teams_csv("teams_export.csv", ctx.teams);
+                        bool json_ok = export_teams_json("teams_export.json", ctx.teams);
+
+                        if (csv_ok && json_ok)
+                        {
+                            ctx.status_message = "Exported teams to teams_export.csv and teams_export.json.";
+                        }
+                        else
+                        {
+                            ctx.status_message = "Export failed, check the console for details.";
+                        }
                     }
                 }
 
@@ -486,53 +937,68 @@ void ui_run(UIContext &ctx)
         float stat_x = AREA_X_START + AREA_W + 20.0;
         float stat_y = 48.0;
         float stat_w = 200.0;
-        float stat_h = 140.0;
+        int extra_lines = (category_count() > 0) + (availability_slots() > 0);
+        float stat_h = 184.0 + 22.0 * extra_lines;
 
         // vector to hold score for each team
-        vector<int> totals;
+        vector<long long> totals;
 
-        // count how many teams have missing leaders
-        int missing_leaders = 0;
+        // count how many roles teams are missing (just leaders unless the roles sidecar adds more)
+        int missing_roles = 0;
+        unsigned required = required_roles();
         for (int ti = 0; ti < ctx.teams.size(); ti++)
         {
             totals.push_back(ctx.teams[ti].total_score);
-            if (!ctx.teams[ti].hasLeader)
-            {
-                missing_leaders++;
-            }
+            missing_roles += __builtin_popcount(required & ~team_coverage(ctx.teams[ti]));
         }
 
         // FROM HERE I WILL CALCULATE METRICS
 
-        // calculate the average of the teams (adding part)
-        double mean = 0.0;
+        // calculate the average of the teams (adding part, exact in fixed point)
+        long long sum = 0;
         for (int z = 0; z < totals.size(); z++)
         {
-            mean += totals[z];
+            sum += totals[z];
         }
 
-        // divide by number of teams
-        if (!totals.empty())
+        // calculate variance from k * sum(t^2) - sum^2 so it's exact until the final divide
+        long long spread = 0;
+        for (int z = 0; z < totals.size(); z++)
         {
-            mean /= totals.size();
+            spread += (long long)totals.size() * totals[z] * totals[z];
         }
+        spread -= sum * sum;
+
+        double var = metric_to_variance(spread, totals.size());
 
-        // calculate variance and standard deviation
-        double var = 0.0;
+        // standard deviation calculation
+        double stddev = sqrt(var);
+
+        // summed per-skill variance, what the skills balance mode minimises
+        double skill_var = metric_to_variance(skill_spread_metric(ctx.teams), ctx.teams.size());
+
+        // what the range and max deviation modes minimise, in whole points
+        long long highest = 0;
+        long long lowest = 0;
         for (int z = 0; z < totals.size(); z++)
         {
-            double d = totals[z] - mean;
-            var += d * d;
+            if (z == 0 || totals[z] > highest)
+            {
+                highest = totals[z];
+            }
+            if (z == 0 || totals[z] < lowest)
+            {
+                lowest = totals[z];
+            }
         }
-
+        double range = (double)(highest - lowest) / SCORE_SCALE;
+        double max_dev = 0.0;
         if (!totals.empty())
         {
-            var /= totals.size();
+            double mean = (double)sum / totals.size();
+            max_dev = std::max(highest - mean, mean - lowest) / SCORE_SCALE;
         }
 
-        // standard deviation calculation
-        double stddev = sqrt(var);
-
         // coordinates for suggestions box
 
         float sugg_x = stat_x;
@@ -593,12 +1059,10 @@ void ui_run(UIContext &ctx)
             draw_text(" Swap " + nameA + " (Team " + std::to_string(teamA + 1) + ")", COLOR_BLACK, sugg_x + 8, y_offset + 16);
             draw_text(" with " + nameB + " (Team " + std::to_string(teamB + 1) + ")", COLOR_BLACK, sugg_x + 8, y_offset + 32);
 
-            // show improvement only if it's not 0
-            double imp = s.delta;
-
-            // i trialed and errored for this one and landed on this number
-            if (imp > 0.000000001 || imp < -0.000000001)
+            // show improvement only if it's not 0 (deltas are exact integers now)
+            if (s.delta != 0)
             {
+                double imp = metric_to_variance(s.delta, ctx.teams.size());
                 std::string text = "Improvement: " + std::to_string(imp);
                 draw_text(text, rgb_color(0, 100, 0), sugg_x + 8, y_offset + 48);
             }
@@ -624,12 +1088,35 @@ void ui_run(UIContext &ctx)
 
         draw_text("Teams: " + std::to_string(ctx.teams.size()), COLOR_BLACK, stat_x + 8.0, stat_y + 30.0);
 
-        draw_text("Missing leaders: " + std::to_string(missing_leaders), COLOR_BLACK, stat_x + 8.0, stat_y + 48.0);
+        draw_text((role_rules().size() == 1 ? "Missing leaders: " : "Missing roles: ") + std::to_string(missing_roles), COLOR_BLACK, stat_x + 8.0, stat_y + 48.0);
 
         draw_text("Variance: " + std::to_string(var), COLOR_BLACK, stat_x + 8.0, stat_y + 70.0);
 
         draw_text("Std dev: " + std::to_string(stddev), COLOR_BLACK, stat_x + 8.0, stat_y + 92.0);
 
+        draw_text("Skill variance: " + std::to_string(skill_var), COLOR_BLACK, stat_x + 8.0, stat_y + 114.0);
+
+        draw_text("Range: " + std::to_string(range), COLOR_BLACK, stat_x + 8.0, stat_y + 136.0);
+
+        draw_text("Max deviation: " + std::to_string(max_dev), COLOR_BLACK, stat_x + 8.0, stat_y + 158.0);
+
+        // the optional lines go under the fixed ones
+        float line_y = stat_y + 180.0;
+
+        // summed variance of every category value's head count across the teams
+        if (category_count() > 0)
+        {
+            double category_var = metric_to_variance(category_spread_metric(ctx.teams), ctx.teams.size()) / CATEGORY_PENALTY;
+            draw_text("Category variance: " + std::to_string(category_var), COLOR_BLACK, stat_x + 8.0, line_y);
+            line_y += 22.0;
+        }
+
+        // common meeting slots the teams are short of between them
+        if (availability_slots() > 0)
+        {
+            draw_text("Slots short: " + std::to_string(total_slots_short(ctx.teams)), COLOR_BLACK, stat_x + 8.0, line_y);
+        }
+
         // pass fixed areas into this function to draw the team cards
         draw_teams_grid(ctx.teams, area_x, scrolled_y_start, area_w, area_h, area_y);
 
@@ -640,13 +1127,14 @@ void ui_run(UIContext &ctx)
         // if no status message, show this message to handle for this case
         if (status.empty())
         {
-            status = "Students: " + std::to_string(ctx.students.size()) + " | Teams: " + std::to_string(ctx.teams.size());
+            status = "Students: " + std::to_string(ctx.students.size() - ctx.cohort.withdrawn_count) + " | Teams: " + std::to_string(ctx.teams.size());
         }
 
         // call wrap function to convert the long message into multiple lines
         std::vector<std::string> lines = wrap_text(status, 27);
-        const float STATUS_START_Y = 456.0;
-        float y = STATUS_START_Y;
+        // status sits just under the last button
+        const UIButton &last_button = ctx.buttons.back();
+        float y = last_button.y + last_button.h + 12.0;
 
         // draw each wrapped line on screen
         for (int i = 0; i < lines.size(); i++)
@@ -6,6 +6,11 @@
 #include "splashkit.h"
 #include <sstream>
 #include "optimizer.h"
+#include "file_watcher.h"
+#include "constraints.h"
+#include "preferences.h"
+#include "swap_queue.h"
+#include "cohort_sync.h"
 
 // a struct for button data
 struct UIButton
@@ -29,11 +34,23 @@ struct UIContext
     std::string status_message;
     bool reading_csv;
     bool reading_teams;
+    bool reading_withdraw;
+    bool reading_team_count;
+    bool reading_rotation;
     rectangle input_rect;
     std::string current_input;
     float scroll_offset_y;
     float max_scroll_y;
     bool suggestions_locked;
+    std::string loaded_csv;  // file the students came from (watched for changes)
+    file_watcher watcher;
+    constraint_store constraints; // pins and apart rules from the csv's sidecar file
+    preference_store preferences; // want / avoid lines from the csv's preferences sidecar
+    preference_graph preference_links; // preferences resolved against students (rebuilt when ids move)
+    balance_mode balance;         // what Suggest and the optimisers balance (toggled by its button)
+    swap_queue queue;             // every team pair's best swap, kept across Apply Top and Optimise
+    bool queue_ready;             // false once the teams changed some other way
+    cohort_index cohort;          // where everyone sits and the withdrawn rows, kept across withdraws
 };
 
 // initalize UI
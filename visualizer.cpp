@@ -1,6 +1,7 @@
 // importing relavent libraries
 #include "structs.h"
 #include "visualizer.h"
+#include "scoring.h"
 #include "splashkit.h"
 #include <string>
 #include <cmath>
@@ -54,15 +55,15 @@ void layout_buttons(UIContext &ctx, float win_w, float win_h)
     float top = 72.0;
     // size of button
     float bw = 180.0;
-    float bh = 36.0;
+    float bh = 30.0;
     // space between buttons
-    float gap = 12.0;
+    float gap = 8.0;
 
     // vector to store label for each button (in order)
     vector<string> labels = {
         "Load CSV", "Compute Scores", "Allocate",
-        "Fix Leaders", "Suggest", "Apply Top",
-        "View Teams", "Quit"};
+        "Fix Leaders", "Suggest", "Apply Top", "Optimise",
+        "Withdraw", "Team Count", "Rotation", "Balance: Total", "Export", "View Teams", "Quit"};
 
     // for loop to create buttons
     for (int i = 0; i < labels.size(); i++)
@@ -91,7 +92,7 @@ void draw_team_card(const team &t, float x, float y, float w, float h)
 
     // team title and score displayed at top left of the card
     draw_text("Team " + to_string(t.id), COLOR_BLACK, x + 8, y + 8);
-    draw_text("Total: " + to_string(t.total_score), COLOR_BLACK, x + 8, y + 28);
+    draw_text("Total: " + format_score(t.total_score), COLOR_BLACK, x + 8, y + 28);
 
     // color indicator for if a team has a leader or not (red if not, green if yes)
     color indicator;
@@ -119,7 +120,7 @@ void draw_team_card(const team &t, float x, float y, float w, float h)
         // write student's name and score inside the chip
 
         // show name and leadership tag
-        std::string name_label = s.name + " (Avg Score: " + to_string(s.student_score) + ")";
+        std::string name_label = s.name + " (Avg Score: " + format_score(s.student_score) + ")";
 
         // if the student's leadership value meets the threshold, show tag in green
         if (s.leadership >= LEADER_THRESHOLD)